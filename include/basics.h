@@ -46,5 +46,6 @@ void sendWiFiInfo();
 void sendETHInfo();
 void getUptime(char *buffer, size_t bufferSize);
 void sendSysInfo();
+void sendPerfInfo();
 void refreshNetworkInfo();
 void setupETH();
\ No newline at end of file
@@ -66,6 +66,16 @@ struct s_cfg_log {
   bool enable = true;
   int level = 3;
   int order = 0;
+  bool mqtt_enable = false;
+  int mqtt_level = 2;
+  int tag_level[LOG_LEVEL_TAGS]; // log level per tag (0 = global log level)
+};
+
+struct s_cfg_syslog {
+  bool enable;
+  char server[64];
+  uint16_t port = 514;
+  int level = 3;
 };
 
 struct s_config {
@@ -77,6 +87,7 @@ struct s_config {
   s_cfg_ntp ntp;
   s_cfg_auth auth;
   s_cfg_log log;
+  s_cfg_syslog syslog;
 };
 
 extern s_config config;
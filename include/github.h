@@ -1,11 +1,25 @@
+#pragma once
 #include <GithubReleaseOTA.h>
 
 struct GithubReleaseInfo {
   char tag[12];
   char asset[128];
+  char fallback[128]; // complete image if the delta patch does not fit the installed firmware
   char url[256];
 };
 
-bool ghGetLatestRelease(GithubRelease *release, GithubReleaseInfo *info);
-int ghStartOtaUpdate(GithubRelease release, const char *asset);
-void ghSetProgressCallback(void (*callback)(int));
\ No newline at end of file
+struct s_ghcheckstat {
+  uint32_t requests;    // requests to the GitHub API
+  uint32_t notModified; // answered with 304 (ETag still valid)
+  uint32_t cacheHits;   // checks answered from the cache
+  uint32_t errors;      // failed requests
+  uint32_t lastMs;      // duration of the last request
+};
+
+extern s_ghcheckstat ghCheckStat;
+
+bool ghRequestLatestRelease();
+bool ghReleaseCheckDone();
+bool ghGetLatestRelease(GithubReleaseInfo *info);
+int ghStartOtaUpdate(const GithubReleaseInfo &info);
+void ghSetProgressCallback(void (*callback)(int));
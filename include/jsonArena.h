@@ -0,0 +1,49 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+/* D E C L A R A T I O N S ****************************************************/
+
+/**
+ * *******************************************************************
+ * @brief   bump allocator for ArduinoJson documents
+ * @details all blocks of a document are taken from one buffer; the buffer
+ *          is reset when the last block is released (e.g. doc.clear() or end
+ *          of scope after serialization). If the buffer is too small, the
+ *          block is taken from the heap and counted as fallback.
+ *          The arena can be used by several tasks at the same time (e.g.
+ *          loop and AsyncTCP): all blocks stay valid until the last one is
+ *          released.
+ * *******************************************************************/
+class JsonArena : public ArduinoJson::Allocator {
+public:
+  JsonArena(const char *name, size_t size);
+
+  void *allocate(size_t size) override;
+  void deallocate(void *ptr) override;
+  void *reallocate(void *ptr, size_t newSize) override;
+
+  const char *getName() const { return name; }
+  size_t getSize() const { return size; }
+  size_t getHighWater() const { return highWater; }
+  uint32_t getFallbacks() const { return fallbacks; }
+  const JsonArena *getNext() const { return next; }
+
+  static const JsonArena *getFirst() { return first; }
+
+private:
+  bool inArena(const void *ptr) const;
+
+  const char *name;       // name of the use site
+  size_t size;            // size of the arena buffer
+  uint8_t *buffer = NULL; // arena buffer (allocated on first use)
+  size_t used = 0;        // used bytes of the arena buffer
+  size_t last = 0;        // offset of the last allocated block
+  size_t highWater = 0;   // max used bytes
+  uint32_t live = 0;      // number of allocated blocks in the arena buffer
+  uint32_t fallbacks = 0; // number of blocks taken from the heap
+  JsonArena *next = NULL; // next arena in the list of all arenas
+  portMUX_TYPE mux;       // protects the arena state (used by several tasks)
+
+  static JsonArena *first; // list of all arenas
+};
@@ -1,22 +1,58 @@
 #pragma once
 #include <Arduino.h>
+#include <esp_log.h>
 
 /* D E C L A R A T I O N S ****************************************************/
 
-#define MAX_LOG_LINES 200 // max log lines
-#define MAX_LOG_ENTRY 128 // max length of one entry
+#define MAX_LOG_LINES 200                         // max log lines
+#define MAX_LOG_ENTRY 128                         // max length of one entry
+#define MAX_LOG_TAGS 16                           // max number of different log tags (index 0 = unknown tag)
+#define MAX_LOG_TAG_LEN 16                        // max length of one log tag
+#define LOG_IDX_WORDS ((MAX_LOG_LINES + 31) / 32) // number of 32bit words for one index bitmap
+#define LOG_RATE_BURST 20                         // max number of messages per tag in a burst
+#define LOG_RATE_PER_SEC 5                        // max number of messages per tag and second (sustained)
+#define LOG_REPEAT_FLUSH_MS 10000                 // report repeated messages after this time at the latest
+#define LOG_LEVEL_TAGS 9                          // number of log tags with adjustable log level
+#define LOG_TAG_MASK_NONE (1UL << 31)             // tag mask bit of unknown tags (matches no entry)
 
+// meta information of one log entry
+struct s_logmeta {
+  time_t time;   // timestamp of the entry
+  uint8_t level; // esp_log_level_t of the entry
+  uint8_t tag;   // index of the tag in the tag table
+  uint8_t text;  // offset of the message text in the buffer line
+};
 
 struct s_logdata {
-  int lastLine;
+  uint32_t head;       // sequence number of the next entry
+  uint32_t tail;       // sequence number of the oldest valid entry
+  uint32_t repeated;   // number of messages collapsed by deduplication
+  uint32_t suppressed; // number of messages suppressed by rate limit
   char buffer[MAX_LOG_LINES][MAX_LOG_ENTRY];
+  s_logmeta meta[MAX_LOG_LINES];
+};
+
+// filter for log queries
+struct s_logfilter {
+  uint32_t tags = 0;                       // bitmask of tag indices (0 = all tags)
+  esp_log_level_t level = ESP_LOG_VERBOSE; // show only entries with this or a higher severity
+  time_t from = 0;                         // show only entries newer than this (0 = no limit)
+  time_t to = 0;                           // show only entries older than this (0 = no limit)
 };
 
 extern s_logdata logData;
+extern const char *logLevelTags[LOG_LEVEL_TAGS];
 
 /* P R O T O T Y P E S ********************************************************/
 void messageSetup();
 void messageCyclic();
-void addLogBuffer(const char *message);
+void addLogBuffer(const char *message, esp_log_level_t level, const char *tag, size_t textOfs);
 void clearLogBuffer();
 void setLogLevel(uint8_t level);
+bool setTagLogLevel(const char *tag, uint8_t level);
+int logQuery(const s_logfilter &filter, uint32_t *result, int maxCount);
+const char *logEntryText(uint32_t seq);
+const s_logmeta *logEntryMeta(uint32_t seq);
+const char *logTagName(uint8_t idx);
+uint32_t logTagMask(const char *tagList);
+esp_log_level_t logLevelFromString(const char *str);
@@ -0,0 +1,31 @@
+#pragma once
+#include <Arduino.h>
+
+/* D E C L A R A T I O N S ****************************************************/
+#define METRICS_SAMPLE_MS 1000 // sample period of dynamic values
+
+// shared snapshot of system metrics for webUI, MQTT and telnet
+struct s_metrics {
+  // static values (sampled once at boot)
+  uint32_t sketchSize;       // size of the app image
+  uint32_t sketchSpace;      // size of the OTA partition
+  float flashUsage;          // flash usage in %
+  uint32_t heapSize;         // total heap size
+  const char *restartReason; // reason of the last restart
+  // dynamic values (sampled once per period)
+  uint32_t freeHeap;        // free heap
+  uint32_t maxAllocHeap;    // largest free heap block
+  uint32_t maxAllocHeapLow; // lowest largest free heap block since boot (heap fragmentation)
+  uint32_t minFreeHeap;     // lowest free heap since boot
+  float heapUsage;          // heap usage in %
+  char uptime[64];          // uptime as text
+  uint32_t samples;         // number of samples
+  uint32_t sampleUs;        // duration of the last sample
+};
+
+extern s_metrics metrics;
+
+/* P R O T O T Y P E S ********************************************************/
+void metricsSetup();
+void metricsCyclic();
+void metricsBenchmark(uint32_t *directUs, uint32_t *cachedUs);
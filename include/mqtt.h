@@ -6,12 +6,25 @@
 #include <config.h>
 #include <language.h>
 
+/* D E C L A R A T I O N S ****************************************************/
+struct s_mqttstat {
+  uint32_t connects;      // number of established connections
+  uint32_t disconnects;   // number of lost connections
+  uint32_t published;     // number of published messages
+  uint32_t publishFailed; // number of messages that could not be published
+  uint32_t received;      // number of received messages
+  uint32_t cmdDropped;    // number of received commands lost because the queue was full
+};
+
+extern s_mqttstat mqttStat;
+
 /* P R O T O T Y P E S ********************************************************/
 const char *addTopic(const char *suffix);
 void mqttSetup();
 void mqttCyclic();
 void checkMqtt();
 void mqttPublish(const char *sendtopic, const char *payload, boolean retained);
+uint16_t mqttPublishBuffer(const char *topic, const char *payload, size_t len, uint8_t qos);
 const char *mqttGetLastError();
 bool mqttIsConnected();
 
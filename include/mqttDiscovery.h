@@ -1,3 +1,4 @@
 #include <mqtt.h>
 
-void mqttDiscoverySetup(bool reset);
\ No newline at end of file
+void mqttDiscoverySetup(bool reset);
+void mqttDiscoveryCyclic();
\ No newline at end of file
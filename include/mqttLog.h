@@ -0,0 +1,15 @@
+#pragma once
+#include <mqtt.h>
+
+/* D E C L A R A T I O N S ****************************************************/
+struct s_mqttlog {
+  uint32_t forwarded; // number of log entries published via mqtt
+  uint32_t dropped;   // number of log entries lost before they could be published
+  uint32_t batches;   // number of published batches
+};
+
+extern s_mqttlog mqttLog;
+
+/* P R O T O T Y P E S ********************************************************/
+void mqttLogCyclic();
+void mqttLogOnPublish(uint16_t packetId);
@@ -0,0 +1,31 @@
+#pragma once
+#include <Arduino.h>
+
+/* D E C L A R A T I O N S ****************************************************/
+#define OTA_DELTA_MAGIC 0x31445745 // "EWD1"
+#define OTA_DELTA_CACHE 256        // read cache for the running image
+#define OTA_DELTA_OUT 256          // output buffer to the OTA writer
+
+// header of a delta patch (generated by scripts/delta_ota.py)
+struct __attribute__((packed)) s_otadeltaheader {
+  uint32_t magic;        // OTA_DELTA_MAGIC
+  uint32_t oldSize;      // size of the image the patch is based on
+  uint32_t newSize;      // size of the resulting image
+  uint8_t oldSha256[32]; // hash of the image the patch is based on
+  uint8_t newSha256[32]; // hash of the resulting image
+};
+
+struct s_otadeltastat {
+  bool compressed;   // last update was compressed
+  bool delta;        // last update was a delta patch
+  uint32_t received; // received bytes (patch or compressed size)
+  uint32_t verifyMs; // time to check the running image
+};
+
+extern s_otadeltastat otaDeltaStat;
+
+/* P R O T O T Y P E S ********************************************************/
+bool otaStreamBegin(size_t size);
+bool otaStreamWrite(const uint8_t *data, size_t len);
+bool otaStreamEnd();
+void otaStreamAbort();
@@ -0,0 +1,21 @@
+#pragma once
+#include <Arduino.h>
+
+/* D E C L A R A T I O N S ****************************************************/
+#define OTA_Z_MAGIC 0x315A5745 // "EWZ1"
+
+// header of a compressed image or patch (generated by scripts/compress_ota.py)
+struct __attribute__((packed)) s_otazheader {
+  uint32_t magic;     // OTA_Z_MAGIC
+  uint32_t size;      // size of the uncompressed data
+  uint8_t sha256[32]; // hash of the uncompressed data
+};
+
+// receives the decompressed data
+typedef bool (*otaInflateOutput)(const uint8_t *data, size_t len);
+
+/* P R O T O T Y P E S ********************************************************/
+bool otaInflateBegin();
+bool otaInflateWrite(const uint8_t *data, size_t len, otaInflateOutput output);
+bool otaInflateDone();
+void otaInflateEnd();
@@ -0,0 +1,51 @@
+#pragma once
+#include <Arduino.h>
+
+/* D E C L A R A T I O N S ****************************************************/
+#define OTA_BUF_SIZE 4096       // size of one buffer (one flash sector)
+#define OTA_BUF_COUNT 2         // number of buffers (double buffering)
+#define OTA_TASK_STACK 4096     // stack size of the writer task
+#define OTA_TASK_PRIO 3         // priority of the writer task (above loop, below AsyncTCP)
+#define OTA_SIM_ERASE_MS 45     // simulated flash: erase time of one sector
+#define OTA_SIM_PAGE_US 600     // simulated flash: program time of one 256 byte page
+#define OTA_SIM_TCP_WINDOW 5744 // simulated network: TCP receive window (lwIP default)
+#define OTA_SIM_RTT_MS 40       // simulated network: default round trip time (internet)
+
+// flash backend of the writer (default: next OTA partition)
+struct s_otaflash {
+  bool (*begin)(size_t size);                     // prepare flash for an image of the given size (0 = unknown)
+  bool (*write)(const uint8_t *data, size_t len); // write next block (sequential, erases on the fly)
+  bool (*end)();                                  // validate image and activate it
+  void (*abort)();                                // discard image
+};
+
+struct s_otastat {
+  bool active;         // update in progress
+  bool pipelined;      // receive and flash write overlap
+  uint32_t size;       // expected image size (0 = unknown)
+  uint32_t bytes;      // received bytes
+  uint32_t durationMs; // total update time
+  uint32_t kbps;       // throughput in KB/s
+  uint32_t flashMs;    // time spent in flash erase/write
+  uint32_t hashMs;     // time spent in SHA-256
+  uint32_t waitMs;     // time the receiver waited for a free buffer
+  char sha256[65];     // SHA-256 of the image as hex string
+  const char *error;   // error of the last update (NULL = ok)
+};
+
+// result of one benchmark run
+struct s_otabench {
+  uint32_t serialMs; // receive, then write (one buffer)
+  uint32_t pipeMs;   // receive while the previous buffer is written
+  uint32_t serialKbps;
+  uint32_t pipeKbps;
+};
+
+extern s_otastat otaStat;
+
+/* P R O T O T Y P E S ********************************************************/
+bool otaWriterBegin(size_t size, const s_otaflash *flash = NULL, bool pipelined = true);
+bool otaWriterWrite(const uint8_t *data, size_t len);
+bool otaWriterEnd(const uint8_t *expectedSha256 = NULL);
+void otaWriterAbort();
+void otaWriterBenchmark(size_t size, uint32_t kbps, uint32_t rttMs, s_otabench *result);
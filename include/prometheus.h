@@ -0,0 +1,18 @@
+#pragma once
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+/* D E C L A R A T I O N S ****************************************************/
+#define PROM_BUFFER_SIZE 12288 // size of the fixed output buffer (~11 KB with SCHED_MAX_TASKS tasks)
+
+// text writer for the Prometheus exposition format (no heap allocation)
+struct s_promwriter {
+  char *buf;     // output buffer
+  size_t size;   // size of the buffer
+  size_t len;    // number of written bytes
+  bool overflow; // buffer was too small
+};
+
+/* P R O T O T Y P E S ********************************************************/
+void prometheusSetup(AsyncWebServer &server);
+size_t prometheusWrite(char *buf, size_t size);
@@ -0,0 +1,49 @@
+#pragma once
+#include <Arduino.h>
+
+/* D E C L A R A T I O N S ****************************************************/
+#define SCHED_MAX_TASKS 16           // max number of tasks
+#define SCHED_LOOP_BUDGET_US 20000   // time budget of one loop iteration (tasks with prio > 0 are deferred)
+#define SCHED_EVERY_LOOP 0           // period: run in every loop iteration
+#define SCHED_EVENT UINT32_MAX       // period: run only if triggered with schedTrigger()
+#define SCHED_HIST_BUCKETS 16        // latency histogram: bucket i counts run times < 2^(i+1) us
+
+// log-bucketed latency histogram
+struct s_schedhist {
+  uint32_t count;                      // number of measurements
+  uint32_t minUs;                      // min run time
+  uint32_t maxUs;                      // max run time
+  uint64_t sumUs;                      // sum of all run times
+  uint32_t bucket[SCHED_HIST_BUCKETS]; // bucket 0: < 2us, bucket i: 2^i ... 2^(i+1)-1 us, last bucket: all above
+};
+
+typedef void (*schedFunction)();
+
+struct s_schedtask {
+  const char *name;    // name of the task
+  schedFunction fn;    // task function
+  uint8_t prio;        // priority (0 = highest, never deferred)
+  uint32_t periodMs;   // period in ms (SCHED_EVERY_LOOP or SCHED_EVENT)
+  uint32_t budgetUs;   // time budget of one run in us
+  uint32_t dueMs;      // time of the next periodic run or of the trigger
+  bool triggered;      // event is pending
+  bool more;           // sliced job has more work - run again in the next iteration
+  s_schedhist hist;    // run time histogram
+  uint32_t overruns;   // number of runs that exceeded the time budget
+  uint32_t misses;     // number of missed periods (deadline misses)
+  uint32_t maxLateMs;  // max lateness of a run compared to its due time
+  uint32_t deferred;   // number of runs deferred because the loop budget was exhausted
+};
+
+/* P R O T O T Y P E S ********************************************************/
+bool schedAdd(const char *name, schedFunction fn, uint8_t prio, uint32_t periodMs, uint32_t budgetUs);
+void schedTrigger(const char *name);
+void schedContinue();
+uint32_t schedTimeLeft();
+void schedCyclic();
+int schedTaskCount();
+const s_schedtask *schedGetTask(int idx);
+const s_schedtask *schedFindTask(const char *name);
+const s_schedhist *schedLoopHist();
+uint32_t schedPercentile(const s_schedhist &hist, uint8_t pct);
+void schedResetStats();
@@ -0,0 +1,15 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <syslogFormat.h>
+
+/* D E C L A R A T I O N S ****************************************************/
+struct s_syslog {
+  uint32_t sent;    // number of sent datagrams
+  uint32_t dropped; // number of log entries that could not be sent
+};
+
+extern s_syslog syslogStat;
+
+/* P R O T O T Y P E S ********************************************************/
+void syslogCyclic();
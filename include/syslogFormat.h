@@ -0,0 +1,10 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/* D E C L A R A T I O N S ****************************************************/
+#define SYSLOG_FACILITY 1 // user-level messages
+
+/* P R O T O T Y P E S ********************************************************/
+size_t syslogFormat(char *buf, size_t size, uint8_t severity, time_t time, const char *host, const char *app, const char *msgId, const char *msg);
@@ -7,9 +7,10 @@
 // data struct for Telnet interface
 struct s_telnetIF {
   bool serialStream;
+  uint32_t droppedBytes; // bytes dropped because the output buffer was full
 };
 
-const int MAX_PAR = 3;
+const int MAX_PAR = 4;
 const int MAX_CHAR = 64;
 
 struct Command {
@@ -25,4 +26,5 @@ extern s_telnetIF telnetIF;
 /* P R O T O T Y P E S ********************************************************/
 void setupTelnet();
 void cyclicTelnet();
-void telnetShell();
\ No newline at end of file
+void telnetShell();
+void telnetStream(const char *msg);
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+/* D E C L A R A T I O N S ****************************************************/
+#define WEB_ASSETS_PARTITION "assets" // name of the partition with the asset bundle
+#define WEB_ASSETS_MAGIC 0x31424157   // "WAB1"
+#define WEB_ASSETS_VERSION 1
+#ifndef WEB_ASSETS_BUNDLE_CRC
+#define WEB_ASSETS_BUNDLE_CRC 0 // crc of the bundle of this build (set by scripts/build_web_assets.py, 0 = any bundle)
+#endif
+
+// header of the asset bundle (generated by scripts/build_web_assets.py)
+struct __attribute__((packed)) s_webassetheader {
+  uint32_t magic;   // WEB_ASSETS_MAGIC
+  uint16_t version; // WEB_ASSETS_VERSION
+  uint16_t count;   // number of assets
+  uint32_t size;    // size of the bundle including this header
+  uint32_t crc;     // crc32 of index and data
+};
+
+// index entry of one asset
+struct __attribute__((packed)) s_webasset {
+  char path[48];     // url (css and js with content hash in the name)
+  char alias[24];    // original url without hash
+  char mime[24];     // content type
+  char hash[12];     // content hash (used as ETag)
+  uint8_t immutable; // content of the url never changes
+  uint8_t reserved[3];
+  uint32_t gzOffset; // gzip compressed content (offset in the bundle)
+  uint32_t gzLen;
+  uint32_t brOffset; // brotli compressed content (0 if not available)
+  uint32_t brLen;
+};
+
+struct s_webassetstat {
+  uint32_t served;      // number of responses with content
+  uint32_t notModified; // number of 304 responses
+  uint32_t brotli;      // number of responses with brotli encoding
+  uint32_t bytes;       // number of sent content bytes
+  uint32_t active;      // number of responses in progress
+  uint32_t maxActive;   // max number of parallel responses
+  uint32_t ttfbMaxUs;   // max time from request to the first content chunk
+  uint32_t heapLow;     // lowest free heap while responses were in progress
+  uint32_t updates;     // number of successful bundle updates
+  uint32_t mismatch;    // bundle does not belong to the firmware
+};
+
+extern s_webassetstat webAssetStat;
+
+/* P R O T O T Y P E S ********************************************************/
+void webAssetsSetup(AsyncWebServer &server, bool serveIndex);
+bool webAssetsValid();
@@ -7,9 +7,16 @@
 #include <EspWebUI.h>
 #include <config.h>
 #include <language.h>
+#include <type_traits>
 
 extern EspWebUI webUI;
 
+// web assets, /metrics, OTA upload and the WebSocket broadcast use the server and socket of EspWebUI
+template <typename T, typename = void> struct s_webUIaccess : std::false_type {};
+template <typename T>
+struct s_webUIaccess<T, std::void_t<decltype(std::declval<T &>().getServer()), decltype(std::declval<T &>().getWebSocket())>> : std::true_type {};
+static_assert(s_webUIaccess<EspWebUI>::value, "EspWebUI without getServer()/getWebSocket() - check the EspWebUI version in platformio.ini");
+
 struct s_example {
   int temp1 = 10;
   int setTemp = 20;
@@ -20,6 +27,14 @@ struct s_example {
 
 extern s_example example;
 
+struct s_webevents {
+  uint32_t received;  // number of received web element events
+  uint32_t coalesced; // number of events merged with a pending event of the same element
+  uint32_t dropped;   // number of events lost because the queue was full
+};
+
+extern s_webevents webEventStat;
+
 /* P R O T O T Y P E S ********************************************************/
 void webUISetup();
 void webUICyclic();
@@ -0,0 +1,26 @@
+#pragma once
+#include <ArduinoJson.h>
+
+/* D E C L A R A T I O N S ****************************************************/
+#define WEB_ELEMENTS_FRAME 0xE5 // first byte of a binary element frame (JSON messages start with '{')
+
+struct s_webelements {
+  uint32_t sent;           // number of sent element values
+  uint32_t skipped;        // number of element values skipped because they did not change
+  uint32_t savedPerMinute; // bytes saved within the last minute
+  uint32_t compactRatio;   // size reduction of element frames (binary or compact JSON) compared to plain JSON in %
+};
+
+extern s_webelements webElements;
+
+/* P R O T O T Y P E S ********************************************************/
+void webElementsBegin(JsonDocument &doc);
+void webElementsSend(JsonDocument &doc);
+void webElementsInvalidate();
+void webElementsReset(uint32_t client);
+void webElementAdd(JsonDocument &doc, const char *id, const char *value);
+void webElementAdd(JsonDocument &doc, const char *id, int value);
+void webElementAdd(JsonDocument &doc, const char *id, long value);
+void webElementAdd(JsonDocument &doc, const char *id, float value);
+size_t measureElements(JsonDocument &doc);
+size_t serializeElements(JsonDocument &doc, uint8_t *output, size_t size);
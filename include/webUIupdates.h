@@ -15,4 +15,8 @@ void updateAllElements();
 void webUIupdates();
 void updateGpioSettings();
 void requestGitHubVersion();
-void requestGitHubUpdate();
\ No newline at end of file
+void requestGitHubUpdate();
+void webLogFilterTags(const char *tags);
+void webLogFilterLevel(const char *level);
+void webLogFilterTime(int minutes);
+void webSetVisiblePage(const char *page);
\ No newline at end of file
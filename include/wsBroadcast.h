@@ -0,0 +1,38 @@
+#pragma once
+#include <ArduinoJson.h>
+
+/* D E C L A R A T I O N S ****************************************************/
+#define WS_BENCH_CLIENTS_MAX 8   // max number of simulated clients of the benchmark
+#define WS_CLIENTS_MAX 8         // max number of clients (at least DEFAULT_MAX_WS_CLIENTS of AsyncWebSocket)
+#define WS_CLIENT_QUEUE_BUDGET 4 // max queued frames per client before updates are merged (below WS_MAX_QUEUED_MESSAGES)
+#define WS_CLIENT_SCAN 16        // client ids that are checked per cycle while a connected client is not tracked yet
+
+struct s_wsbroadcast {
+  uint32_t frames;  // number of broadcast frames
+  uint32_t bytes;   // serialized bytes (once per frame, not per client)
+  uint32_t clients; // number of clients of the last broadcast
+  uint32_t lastUs;  // duration of the last broadcast
+  uint32_t maxUs;   // longest broadcast
+  // backpressure
+  uint32_t slowClients; // clients over their queue budget with merged updates
+  uint32_t merged;      // frames merged into the pending state of a slow client
+  uint32_t coalesced;   // pending values replaced by a newer value
+  uint32_t flushed;     // merged frames sent after the client has caught up
+};
+
+// result of one benchmark run
+struct s_wsbench {
+  uint32_t perClientUs;   // serialize for every client
+  uint32_t onceUs;        // serialize once and share the buffer
+  uint32_t perClientHeap; // heap used by the per client buffers
+  uint32_t onceHeap;      // heap used by the shared buffer
+};
+
+extern s_wsbroadcast wsBroadcastStat;
+
+/* P R O T O T Y P E S ********************************************************/
+void wsBroadcastJSON(JsonDocument &doc);
+void wsSendJSON(uint32_t id, JsonDocument &doc);
+int wsClientIds(uint32_t *ids, int max);
+void wsBroadcastCyclic();
+void wsBroadcastBenchmark(JsonDocument &doc, int clients, s_wsbench *result);
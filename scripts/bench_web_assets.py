@@ -0,0 +1,73 @@
+# Measure time to first byte of the web assets with parallel requests.
+#
+# usage: python scripts/bench_web_assets.py <ip> [parallel] [rounds]
+#
+# The page and all files referenced by it are requested by <parallel> clients at the same time.
+# Heap usage on the device is shown by the telnet command "info" (Web asset bundle: ... heap low).
+import gzip
+import http.client
+import re
+import sys
+import threading
+import time
+
+
+def fetch(host, path, results):
+    start = time.perf_counter()
+    conn = http.client.HTTPConnection(host, 80, timeout=10)
+    try:
+        conn.request("GET", path, headers={"Accept-Encoding": "gzip, br"})
+        response = conn.getresponse()
+        response.read(1)
+        ttfb = time.perf_counter() - start
+        size = 1 + len(response.read())
+        results.append((path, response.status, ttfb, time.perf_counter() - start, size))
+    except OSError as error:
+        results.append((path, str(error), 0, 0, 0))
+    finally:
+        conn.close()
+
+
+def percentile(values, pct):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * pct / 100))] if values else 0
+
+
+def main():
+    if len(sys.argv) < 2:
+        print("usage: python scripts/bench_web_assets.py <ip> [parallel] [rounds]")
+        sys.exit(1)
+    host = sys.argv[1]
+    parallel = int(sys.argv[2]) if len(sys.argv) > 2 else 4
+    rounds = int(sys.argv[3]) if len(sys.argv) > 3 else 5
+
+    conn = http.client.HTTPConnection(host, 80, timeout=10)
+    conn.request("GET", "/", headers={"Accept-Encoding": "gzip"})
+    response = conn.getresponse()
+    page = response.read()
+    if response.getheader("Content-Encoding") == "gzip":
+        page = gzip.decompress(page)
+    page = page.decode("utf-8", errors="ignore")
+    paths = ["/"] + re.findall(r'(?:href|src)="/?([\w.-]+\.(?:css|js))"', page)
+    paths = ["/" + p.lstrip("/") for p in paths]
+
+    results = []
+    for _ in range(rounds):
+        threads = [threading.Thread(target=fetch, args=(host, path, results)) for path in paths for _ in range(parallel)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+
+    print("%-28s %5s %10s %10s %10s %8s" % ("path", "n", "ttfb p50", "ttfb p99", "total p50", "bytes"))
+    for path in paths:
+        rows = [r for r in results if r[0] == path and r[1] == 200]
+        errors = len([r for r in results if r[0] == path and r[1] != 200])
+        ttfb = [r[2] * 1000 for r in rows]
+        total = [r[3] * 1000 for r in rows]
+        size = rows[0][4] if rows else 0
+        print("%-28s %5d %8.1fms %8.1fms %8.1fms %8d%s" % (path, len(rows), percentile(ttfb, 50), percentile(ttfb, 99), percentile(total, 50), size,
+                                                        "  errors: %d" % errors if errors else ""))
+
+
+main()
@@ -2,14 +2,22 @@ Import("env")
 import os
 import re
 import shutil
+import sys
 
+sys.path.insert(0, env.subst("$PROJECT_DIR/scripts"))
+import compress_ota
+import release_deltas as release_deltas_py
 
-OTA_NAME = "esp32_webui_ota_update"     # prefix for ota release image
-INSTALL_NAME = "esp32_webui_flash"      # prefix for merged flash image
+
+OTA_Z_NAME = "esp32_webui_ota_compressed"  # prefix for compressed ota release image
+INSTALL_NAME = "esp32_webui_flash"         # prefix for merged flash image
+ASSETS_NAME = "esp32_webui_assets"         # prefix for web asset bundle
 
 APP_BIN = "$BUILD_DIR/${PROGNAME}.bin"
 MERGED_BIN = "$BUILD_DIR/${PROGNAME}_merged.bin"
+ASSETS_BIN = "$BUILD_DIR/webassets.bin"
 RELEASE_PATH = "$PROJECT_DIR/release"
+HISTORY_PATH = "$PROJECT_DIR/release_history" # ota images of previous releases (base of the delta images)
 BOARD_CONFIG = env.BoardConfig()
 
 
@@ -24,6 +32,10 @@ def extract_version():
         else:
             return None
 
+# delta images against previous releases (explicit target - no downloads and diffs in every build)
+def release_deltas(source, target, env):
+    release_deltas_py.create_deltas(env.subst(APP_BIN), extract_version(), env.subst(RELEASE_PATH), env.subst(HISTORY_PATH))
+
 def merge_bin(source, target, env):
     # The list contains all extra images (bootloader, partitions, eboot) and
     # the final application binary
@@ -54,10 +66,32 @@ def merge_bin(source, target, env):
 
     version = extract_version() # get version from config 
     merged_file = os.path.join(release_path, f"{INSTALL_NAME}_{version}.bin")  # path and name of merged image
-    ota_update_file = os.path.join(release_path, f"{OTA_NAME}_{version}.bin") # path and name of ota image
+    ota_update_file = os.path.join(release_path, release_deltas_py.ota_name(version)) # path and name of ota image (name of the delta base)
     shutil.copyfile(env.subst(MERGED_BIN), merged_file) # copy files
     shutil.copyfile(env.subst(APP_BIN), ota_update_file) # copy files
 
+    # compressed ota image (decompressed on the device while it is written)
+    with open(ota_update_file, "rb") as f:
+        image = f.read()
+    compressed = compress_ota.compress(image)
+    with open(os.path.join(release_path, f"{OTA_Z_NAME}_{version}.bin"), "wb") as f:
+        f.write(compressed)
+    print(f"compressed ota image: {len(compressed)} bytes ({len(compressed) * 100 / len(image):.1f}% of {len(image)} bytes)")
+
+    # web asset bundle (can be updated independent of the firmware via http://<ip>/assets)
+    assets_file = os.path.join(release_path, f"{ASSETS_NAME}_{version}.bin")
+    if os.path.exists(env.subst(ASSETS_BIN)):
+        shutil.copyfile(env.subst(ASSETS_BIN), assets_file)
+
 
 # Add a post action that runs esptoolpy to merge available flash images
-env.AddPostAction(APP_BIN , merge_bin)
\ No newline at end of file
+env.AddPostAction(APP_BIN , merge_bin)
+
+# pio run -t release_deltas: delta images from the previous GitHub releases (scripts/release_deltas.py)
+env.AddCustomTarget(
+    name="release_deltas",
+    dependencies=APP_BIN,
+    actions=release_deltas,
+    title="Release Deltas",
+    description="Create delta OTA images from the previous GitHub releases",
+)
\ No newline at end of file
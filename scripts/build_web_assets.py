@@ -0,0 +1,382 @@
+# Build precompressed, content-hashed web assets and embed them as C arrays.
+#
+# - unused css rules and js functions are removed and all files are minified
+# - css and js files get a content hash in their name (lib.css -> lib.1a2b3c4d.css)
+#   and the references in index.html are replaced with the hashed names
+# - all files are gzip compressed (and brotli compressed if the module is installed)
+# - the result is written as asset bundle (webassets.bin) for the "assets" partition
+#   and served by src/webAssets.cpp directly from flash
+# - the crc of the bundle is passed to the firmware (WEB_ASSETS_BUNDLE_CRC), a bundle of
+#   another build is not used by the firmware (built-in web files instead)
+# - a size report is printed and the build fails if the served size exceeds the budget
+#   (largest encoding per file - a browser loads one encoding of each file)
+#
+# usage: as PlatformIO pre-script or standalone: python scripts/build_web_assets.py [budget]
+#
+# bundle layout (little endian):
+#   header  16 bytes: magic "WAB1", version (u16), count (u16), size of the bundle (u32), crc32 of index and data (u32)
+#   index  128 bytes per asset: path[48], alias[24], mime[24], hash[12], immutable (u8), reserved[3],
+#                               gzip offset (u32), gzip length (u32), brotli offset (u32), brotli length (u32)
+#   data   compressed files, 4 byte aligned
+import glob
+import gzip
+import hashlib
+import os
+import re
+import struct
+import sys
+import zlib
+
+try:
+    Import("env")  # noqa: F821 (PlatformIO)
+    PROJECT_DIR = env.subst("$PROJECT_DIR")  # noqa: F821
+    BUNDLE_FILE = env.subst("$BUILD_DIR/webassets.bin")  # noqa: F821
+    FLASH_BUDGET = int(env.GetProjectOption("custom_web_flash_budget", "0"))  # noqa: F821
+except NameError:
+    env = None
+    PROJECT_DIR = os.path.abspath(os.path.join(os.path.dirname(sys.argv[0]), ".."))
+    BUNDLE_FILE = os.path.join(PROJECT_DIR, ".pio", "webassets.bin")
+    FLASH_BUDGET = int(sys.argv[1]) if len(sys.argv) > 1 else 0
+
+try:
+    import brotli
+except ImportError:
+    brotli = None
+
+WEB_DIR = os.path.join(PROJECT_DIR, "web", "output")
+PARTITION_FILE = os.path.join(PROJECT_DIR, "partitions.csv")
+PARTITION_NAME = "assets"
+BUNDLE_MAGIC = b"WAB1"
+BUNDLE_VERSION = 1
+INDEX_FILE = "index.html"
+HASHED_FILES = ["lib.css", "user.css", "lib.js", "user.js"]  # referenced by index.html
+MIME_TYPES = {".html": "text/html", ".css": "text/css", ".js": "application/javascript"}
+USAGE_SOURCES = ["web/html/*.html", "web/js/*.js", "web/output/*.js", "src/*.cpp", "include/*.h"]  # class/id/function users
+NESTED_AT_RULES = ("@media", "@supports", "@-moz-document")  # at-rules that contain normal rules
+
+
+# ----------------------------------------------------------------------
+# pruning and minification
+# ----------------------------------------------------------------------
+def skip_string(text, i):
+    """return the index after the string literal that starts at text[i]"""
+    quote = text[i]
+    i += 1
+    while i < len(text) and text[i] != quote:
+        i += 2 if text[i] == "\\" else 1
+    return i + 1
+
+
+def used_words():
+    """all identifiers in the page fragments, scripts and firmware sources (class names are also set by the firmware)"""
+    words = set()
+    for pattern in USAGE_SOURCES:
+        for path in glob.glob(os.path.join(PROJECT_DIR, pattern)):
+            with open(path, "r", encoding="utf-8", errors="ignore") as f:
+                words.update(re.findall(r"[A-Za-z_][\w-]*", f.read()))
+    return words
+
+
+def css_blocks(css):
+    """split css into (prelude, body) tuples - body is None for statements like @charset"""
+    blocks = []
+    i = start = 0
+    while i < len(css):
+        c = css[i]
+        if c in "\"'":
+            i = skip_string(css, i)
+        elif css.startswith("/*", i):
+            end = css.find("*/", i + 2) + 2
+            if css.startswith("/*!", i):
+                blocks.append((css[i:end], None))  # keep license comments
+            else:
+                css = css[:i] + css[end:]
+                continue
+            i = start = end
+        elif c == ";":
+            blocks.append((css[start : i + 1].strip(), None))
+            i = start = i + 1
+        elif c == "{":
+            depth, j = 1, i + 1
+            while depth:
+                if css[j] in "\"'":
+                    j = skip_string(css, j)
+                    continue
+                depth += {"{": 1, "}": -1}.get(css[j], 0)
+                j += 1
+            blocks.append((css[start:i].strip(), css[i + 1 : j - 1]))
+            i = start = j
+        else:
+            i += 1
+    return blocks
+
+
+def selector_used(selector, words, prefixes):
+    """a selector is used if all of its classes and ids are used (contents of :not(), :is() ... are ignored)"""
+    selector = re.sub(r"\([^()]*\)", "", selector)
+    selector = re.sub(r"\[[^\]]*\]", "", selector)
+    for name in re.findall(r"[.#](-?[A-Za-z_][\w-]*)", selector):
+        if name not in words and not any(name.startswith(p) for p in prefixes):
+            return False
+    return True
+
+
+def prune_css(css, words):
+    prefixes = [w for w in words if len(w) > 2 and w[-1] in "_-"]  # e.g. "i_wifi_" + level
+    output = []
+    for prelude, body in css_blocks(css):
+        if body is None:
+            output.append(prelude)
+        elif prelude.startswith(NESTED_AT_RULES):
+            inner = prune_css(body, words)
+            if inner:
+                output.append("%s{%s}" % (prelude, inner))
+        elif prelude.startswith("@"):
+            output.append("%s{%s}" % (prelude, minify_css_body(body)))
+        else:
+            selectors = [sel.strip() for sel in split_selectors(prelude)]
+            selectors = [sel for sel in selectors if selector_used(sel, words, prefixes)]
+            if selectors:
+                output.append("%s{%s}" % (",".join(selectors), minify_css_body(body)))
+    return "".join(output)
+
+
+def split_selectors(prelude):
+    """split selector list at commas that are not inside brackets"""
+    parts, depth, start = [], 0, 0
+    for i, c in enumerate(prelude):
+        depth += {"(": 1, "[": 1, ")": -1, "]": -1}.get(c, 0)
+        if c == "," and depth == 0:
+            parts.append(prelude[start:i])
+            start = i + 1
+    parts.append(prelude[start:])
+    return [re.sub(r"\s+", " ", p) for p in parts]
+
+
+def minify_css_body(body):
+    """collapse whitespace outside of strings"""
+    parts = re.split(r"(\"(?:\\.|[^\"\\])*\"|'(?:\\.|[^'\\])*')", body)
+    for i in range(0, len(parts), 2):
+        parts[i] = re.sub(r"\s*([;{}])\s*", r"\1", re.sub(r"\s+", " ", parts[i]))
+    return "".join(parts).strip().rstrip(";")
+
+
+REGEX_KEYWORDS = ("return", "typeof", "case", "do", "else", "in", "of", "new", "delete", "void", "throw", "instanceof", "yield", "await")
+
+
+def regex_allowed(last):
+    """a "/" starts a regex literal if the last token is no operand (identifier, number, ")" or "]")"""
+    if not last:
+        return True
+    if last[-1].isalnum() or last[-1] in "_$":
+        return last in REGEX_KEYWORDS
+    return last not in (")", "]", '"')
+
+
+def regex_end(js, i):
+    """return the index after the regex literal that starts at js[i] (None if it is not terminated in this line)"""
+    j = i + 1
+    in_class = False
+    while j < len(js) and js[j] != "\n":
+        if js[j] == "\\":
+            j += 2
+            continue
+        if js[j] == "[":
+            in_class = True
+        elif js[j] == "]":
+            in_class = False
+        elif js[j] == "/" and not in_class:
+            return j + 1
+        j += 1
+    return None
+
+
+def strip_js_comments(js):
+    """remove comments - strings, template literals and regex literals are kept"""
+    output = []
+    last = ""  # last token that is not whitespace or a comment
+    i = 0
+    while i < len(js):
+        c = js[i]
+        if c in "\"'`":
+            end = skip_string(js, i)
+            output.append(js[i:end])
+            last = '"'
+            i = end
+        elif js.startswith("//", i):
+            i = js.find("\n", i)
+            i = len(js) if i < 0 else i
+        elif js.startswith("/*", i):
+            i = js.find("*/", i + 2)
+            i = len(js) if i < 0 else i + 2
+        elif c == "/" and regex_allowed(last) and regex_end(js, i):
+            end = regex_end(js, i)
+            output.append(js[i:end])
+            last = '"'
+            i = end
+        else:
+            output.append(c)
+            if c.isalnum() or c in "_$":
+                # extend identifier / keyword / number
+                last = last + c if last and (last[-1].isalnum() or last[-1] in "_$") and not js[i - 1].isspace() else c
+            elif not c.isspace():
+                last = c
+            i += 1
+    return "".join(output)
+
+
+def js_functions(js):
+    """top level function declarations: name -> (start, end)"""
+    functions = {}
+    for match in re.finditer(r"^(?:async\s+)?function\s+([A-Za-z_$][\w$]*)\s*\(", js, re.M):
+        i = js.index("{", match.end())
+        depth = 0
+        while True:
+            if js[i] in "\"'`":
+                i = skip_string(js, i)
+                continue
+            depth += {"{": 1, "}": -1}.get(js[i], 0)
+            i += 1
+            if depth == 0:
+                break
+        functions[match.group(1)] = (match.start(), i)
+    return functions
+
+
+def prune_js(js, others):
+    """remove top level functions that are not referenced (repeated until nothing changes)"""
+    removed = []
+    while True:
+        unused = None
+        for name, (start, end) in js_functions(js).items():
+            rest = js[:start] + js[end:] + others
+            if not re.search(r"(?<![\w$])%s(?![\w$])" % re.escape(name), rest):
+                unused = (name, start, end)
+                break
+        if unused is None:
+            return js, removed
+        removed.append(unused[0])
+        js = js[: unused[1]] + js[unused[2] :]
+
+
+def minify_js(js):
+    lines = (line.strip() for line in strip_js_comments(js).split("\n"))
+    return "\n".join(line for line in lines if line)
+
+
+def minify_html(html):
+    html = re.sub(r"<!--(?!\s*\[).*?-->", "", html, flags=re.S)
+    lines = (line.strip() for line in html.split("\n"))
+    return "\n".join(line for line in lines if line)
+
+
+def content_hash(data):
+    return hashlib.sha256(data).hexdigest()[:8]
+
+
+def fail(message):
+    print("web asset: ERROR - " + message)
+    if env is not None:
+        env.Exit(1)
+    sys.exit(1)
+
+
+def partition_info():
+    """offset and size of the asset partition from partitions.csv"""
+    with open(PARTITION_FILE, "r") as f:
+        for line in f:
+            cols = [c.strip() for c in line.split("#")[0].split(",")]
+            if len(cols) >= 5 and cols[0] == PARTITION_NAME:
+                return int(cols[3], 0), int(cols[4], 0)
+    fail("partition '%s' not found in %s" % (PARTITION_NAME, PARTITION_FILE))
+
+
+def build_assets():
+    assets = []  # (path, alias, mime, hash, immutable, raw data)
+    words = used_words()
+    sources = {}
+    for filename in [INDEX_FILE] + HASHED_FILES:
+        with open(os.path.join(WEB_DIR, filename), "r", encoding="utf-8") as f:
+            sources[filename] = f.read()
+    original_size = {name: len(text.encode("utf-8")) for name, text in sources.items()}
+
+    index = minify_html(sources[INDEX_FILE])
+
+    for filename in HASHED_FILES:
+        text = sources[filename]
+        if filename.endswith(".css"):
+            text = prune_css(text, words)
+        else:
+            others = "".join(t for name, t in sources.items() if name != filename)
+            text, removed = prune_js(text, others)
+            for name in removed:
+                print("web asset: %s: removed unused function %s()" % (filename, name))
+            text = minify_js(text)
+        data = text.encode("utf-8")
+        digest = content_hash(data)
+        base, ext = os.path.splitext(filename)
+        hashed_name = "%s.%s%s" % (base, digest, ext)
+        index = index.replace('"%s"' % filename, '"%s"' % hashed_name)
+        assets.append(("/" + hashed_name, "/" + filename, MIME_TYPES[ext], digest, True, data, original_size[filename]))
+
+    data = index.encode("utf-8")
+    assets.insert(0, ("/", "/" + INDEX_FILE, MIME_TYPES[".html"], content_hash(data), False, data, original_size[INDEX_FILE]))
+    return assets
+
+
+def align4(data):
+    return data + b"\0" * (-len(data) % 4)
+
+
+def generate_bundle(assets):
+    index = b""
+    data = b""
+    data_offset = 16 + 128 * len(assets)
+    total_gz = total_br = total_served = 0
+    print("web asset: %-24s %8s %8s %8s %8s" % ("", "source", "pruned", "gzip", "brotli"))
+    for path, alias, mime, digest, immutable, raw, source_size in assets:
+        gz = gzip.compress(raw, compresslevel=9, mtime=0)
+        br = brotli.compress(raw, quality=11) if brotli is not None else b""
+        gz_offset = data_offset + len(data)
+        data = align4(data + gz)
+        br_offset = data_offset + len(data) if br else 0
+        data = align4(data + br)
+        index += struct.pack(
+            "<48s24s24s12sB3xIIII",
+            path.encode(), alias.encode(), mime.encode(), digest.encode(), immutable, gz_offset, len(gz), br_offset, len(br)
+        )
+        total_gz += len(gz)
+        total_br += len(br)
+        total_served += max(len(gz), len(br))
+        print("web asset: %-24s %8d %8d %8d %8s" % (path, source_size, len(raw), len(gz), len(br) or "-"))
+
+    body = index + data
+    header = struct.pack("<4sHHII", BUNDLE_MAGIC, BUNDLE_VERSION, len(assets), 16 + len(body), zlib.crc32(body))
+    bundle = header + body
+
+    # size budget: bytes a browser loads - one encoding per file, the larger one if both are stored
+    offset, size = partition_info()
+    print(
+        "web asset: bundle %d bytes (gzip: %d, brotli: %d, served: %d, budget: %s, partition: %d)"
+        % (len(bundle), total_gz, total_br, total_served, FLASH_BUDGET or "none", size)
+    )
+    if FLASH_BUDGET and total_served > FLASH_BUDGET:
+        fail("web asset budget exceeded by %d bytes" % (total_served - FLASH_BUDGET))
+    if len(bundle) > size:
+        fail("bundle does not fit into the '%s' partition" % PARTITION_NAME)
+    return bundle, offset, zlib.crc32(body)
+
+
+def main():
+    bundle, offset, crc = generate_bundle(build_assets())
+    os.makedirs(os.path.dirname(BUNDLE_FILE), exist_ok=True)
+    with open(BUNDLE_FILE, "wb") as f:
+        f.write(bundle)
+    # flash the bundle together with the firmware (upload and merged image)
+    if env is not None:
+        env.Append(FLASH_EXTRA_IMAGES=[("0x%x" % offset, BUNDLE_FILE)])
+        # link the firmware to this bundle
+        env.Append(CPPDEFINES=[("WEB_ASSETS_BUNDLE_CRC", "0x%08x" % crc)])
+
+
+main()
@@ -0,0 +1,54 @@
+# Check the installed EspWebUI library before anything is compiled.
+#
+# - web assets, /metrics, OTA upload and the WebSocket broadcast use getServer() and
+#   getWebSocket() of EspWebUI (include/webUI.h) - a version of lib_deps without them
+#   stops the build here with the installed version instead of a compile error
+# - the installed version (and the commit of a git dependency) is printed, so a
+#   working version can be pinned in platformio.ini
+#
+# usage: as PlatformIO pre-script or standalone: python scripts/check_espwebui.py <libdeps dir>
+import glob
+import json
+import os
+import re
+import sys
+
+REQUIRED = ("getServer", "getWebSocket")
+
+try:
+    Import("env")  # noqa: F821 (PlatformIO)
+    LIBDEPS_DIR = env.subst("$PROJECT_LIBDEPS_DIR/$PIOENV")  # noqa: F821
+except NameError:
+    env = None
+    LIBDEPS_DIR = sys.argv[1] if len(sys.argv) > 1 else "."
+
+
+def fail(message):
+    print("EspWebUI: ERROR - " + message)
+    if env is not None:
+        env.Exit(1)
+    sys.exit(1)
+
+
+# version of the installed library (PlatformIO package manifest, e.g. "1.2.0+sha.1a2b3c4")
+def installed_version(lib_dir):
+    for name in (".piopm", "library.json"):
+        try:
+            with open(os.path.join(lib_dir, name)) as f:
+                return json.load(f).get("version", "?")
+        except (OSError, ValueError):
+            continue
+    return "?"
+
+
+headers = glob.glob(os.path.join(LIBDEPS_DIR, "*", "src", "EspWebUI.h"))
+if not headers:
+    print("EspWebUI: not installed yet in %s - checked by include/webUI.h" % LIBDEPS_DIR)
+else:
+    lib_dir = os.path.dirname(os.path.dirname(headers[0]))
+    source = open(headers[0], encoding="utf-8", errors="replace").read()
+    missing = [name for name in REQUIRED if not re.search(r"\b%s\s*\(" % name, source)]
+    version = installed_version(lib_dir)
+    if missing:
+        fail("version %s has no %s() - pin a version with %s() in platformio.ini" % (version, "(), ".join(missing), "() and ".join(REQUIRED)))
+    print("EspWebUI: version %s provides %s()" % (version, "() and ".join(REQUIRED)))
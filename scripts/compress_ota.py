@@ -0,0 +1,102 @@
+# Compressed OTA images (raw deflate, decompressed on the device by src/otaInflate.cpp)
+#
+# usage: python scripts/compress_ota.py compress <image.bin> <compressed.bin>
+#        python scripts/compress_ota.py decompress <compressed.bin> <image.bin>
+#        python scripts/compress_ota.py bench [firmware.bin]
+#
+# format (little endian):
+#   header   "EWZ1", u32 size of the uncompressed data, sha256 of the uncompressed data
+#   data     raw deflate stream (32 KB window, the window of the ROM decompressor)
+# The uncompressed data can be a firmware image or a delta patch of scripts/delta_ota.py.
+import hashlib
+import random
+import struct
+import sys
+import time
+import zlib
+
+MAGIC = b"EWZ1"
+HEADER = struct.Struct("<4sI32s")
+
+WINDOW_BITS = 15  # 32 KB window (TINFL_LZ_DICT_SIZE)
+LEVEL = 9
+CHUNK = 1436      # input chunk of the decompressor in the benchmark (one TCP segment)
+
+
+def compress(data):
+    """compress image or patch"""
+    deflate = zlib.compressobj(LEVEL, zlib.DEFLATED, -WINDOW_BITS, 9)
+    return HEADER.pack(MAGIC, len(data), hashlib.sha256(data).digest()) + deflate.compress(data) + deflate.flush()
+
+
+def is_compressed(data):
+    return data[:4] == MAGIC
+
+
+def decompress(data, chunk=CHUNK):
+    """streaming decompression in chunks of the network size (same as the device)"""
+    magic, size, sha = HEADER.unpack_from(data)
+    if magic != MAGIC:
+        raise ValueError("not compressed")
+    inflate = zlib.decompressobj(-WINDOW_BITS)
+    out = bytearray()
+    for pos in range(HEADER.size, len(data), chunk):
+        out += inflate.decompress(data[pos:pos + chunk])
+    if not inflate.eof or inflate.unused_data:
+        raise ValueError("compressed data incomplete or corrupt")
+    if len(out) != size or hashlib.sha256(out).digest() != sha:
+        raise ValueError("result does not match the header")
+    return bytes(out)
+
+
+def bench(path=None):
+    """compression ratio and decompression throughput"""
+    if path:
+        with open(path, "rb") as f:
+            image = f.read()
+    else:
+        # firmware like data: code with repeated patterns, strings and some random data
+        rnd = random.Random(1)
+        words = [bytes(rnd.getrandbits(8) for _ in range(rnd.randrange(2, 12))) for _ in range(2000)]
+        image = b"".join(rnd.choice(words) for _ in range(150000))[: 1024 * 1024]
+
+    start = time.perf_counter()
+    packed = compress(image)
+    compress_s = time.perf_counter() - start
+
+    rounds = 5
+    start = time.perf_counter()
+    for _ in range(rounds):
+        ok = decompress(packed) == image
+    inflate_s = (time.perf_counter() - start) / rounds
+
+    print("image:        %8d bytes" % len(image))
+    print("compressed:   %8d bytes (%.1f%%, header %d bytes)" % (len(packed), len(packed) * 100.0 / len(image), HEADER.size))
+    print("compress:     %8.2f s" % compress_s)
+    print("decompress:   %8.1f MB/s (chunks of %d bytes, %s)" % (len(image) / inflate_s / 1e6, CHUNK, "ok" if ok else "FAIL"))
+    for kbps in (50, 100, 200):
+        print("transfer at %3d KB/s: %5.1f s -> %5.1f s" % (kbps, len(image) / 1024.0 / kbps, len(packed) / 1024.0 / kbps))
+    try:
+        decompress(packed[:-10])
+        print("truncated:    FAIL (not detected)")
+        ok = False
+    except ValueError:
+        print("truncated:    ok (rejected)")
+    return ok
+
+
+if __name__ == "__main__":
+    if len(sys.argv) == 4 and sys.argv[1] in ("compress", "decompress"):
+        with open(sys.argv[2], "rb") as f:
+            data = f.read()
+        out = compress(data) if sys.argv[1] == "compress" else decompress(data)
+        with open(sys.argv[3], "wb") as f:
+            f.write(out)
+        print("%d -> %d bytes" % (len(data), len(out)))
+    elif len(sys.argv) in (2, 3) and sys.argv[1] == "bench":
+        sys.exit(0 if bench(sys.argv[2] if len(sys.argv) == 3 else None) else 1)
+    else:
+        print("usage: python scripts/compress_ota.py compress <image.bin> <compressed.bin>")
+        print("       python scripts/compress_ota.py decompress <compressed.bin> <image.bin>")
+        print("       python scripts/compress_ota.py bench [firmware.bin]")
+        sys.exit(1)
@@ -0,0 +1,240 @@
+# Binary delta patches for OTA updates (bsdiff style, applied on the device by src/otaDelta.cpp)
+#
+# usage: python scripts/delta_ota.py diff <old.bin> <new.bin> <patch.bin>
+#        python scripts/delta_ota.py apply <old.bin> <patch.bin> <new.bin>
+#        python scripts/delta_ota.py selftest [firmware.bin]
+#
+# patch format (little endian):
+#   header   "EWD1", u32 old size, u32 new size, sha256 of old image, sha256 of new image
+#   ops      COPY n          copy n bytes from old (old position advances)
+#            ADD n, data     n bytes old + data (byte wise, mod 256) - old position advances
+#            INSERT n, data  n new bytes (old position stays)
+#            SEEK d          move old position by d (zigzag varint)
+#            END
+#   n and d are LEB128 varints. ADD is used for regions that are mostly equal but differ in
+#   some bytes (e.g. shifted addresses after a code change), so the data is mostly small.
+import hashlib
+import random
+import re
+import struct
+import sys
+import time
+
+MAGIC = b"EWD1"
+HEADER = struct.Struct("<4sII32s32s")
+
+OP_END = 0
+OP_COPY = 1
+OP_ADD = 2
+OP_INSERT = 3
+OP_SEEK = 4
+
+GRAM = 8          # length of the exact match that starts a region
+GIVE_UP = 64      # stop extending a region if its score is this far below the best score
+ZERO_RUN = 4      # min run of equal bytes that is sent as COPY instead of ADD data
+
+
+def _varint(value):
+    out = bytearray()
+    while True:
+        byte = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def _zigzag(value):
+    return (value << 1) if value >= 0 else ((-value << 1) - 1)
+
+
+def _read_varint(data, pos):
+    value = shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def _extend(old, new, o, n):
+    """length of the region new[n:] ~ old[o:] with more than 50% equal bytes (as bsdiff)"""
+    limit = min(len(old) - o, len(new) - n)
+    score = best = length = 0
+    for j in range(limit):
+        score += 1 if old[o + j] == new[n + j] else -1
+        if score > best:
+            best = score
+            length = j + 1
+        elif score < best - GIVE_UP:
+            break
+    return length
+
+
+def _emit_region(ops, old, new, o, n, length):
+    """COPY for equal runs, ADD with the byte differences for the rest"""
+    diff = bytes((a - b) & 0xFF for a, b in zip(new[n:n + length], old[o:o + length]))
+    pos = 0
+    for run in re.finditer(b"\x00{%d,}" % ZERO_RUN, diff):
+        if run.start() > pos:
+            ops += bytes([OP_ADD]) + _varint(run.start() - pos) + diff[pos:run.start()]
+        ops += bytes([OP_COPY]) + _varint(run.end() - run.start())
+        pos = run.end()
+    if pos < length:
+        ops += bytes([OP_ADD]) + _varint(length - pos) + diff[pos:]
+
+
+def create_patch(old, new):
+    """create patch that turns old into new"""
+    index = {}
+    for i in range(len(old) - GRAM + 1):
+        index.setdefault(old[i:i + GRAM], i)
+
+    ops = bytearray()
+    insert = bytearray()
+    old_pos = 0   # old position of the applier
+    align = None  # offset old - new of the last region
+    n = 0
+    while n < len(new):
+        gram = new[n:n + GRAM]
+        o = None
+        if len(gram) == GRAM:
+            # prefer the alignment of the last region (code that only moved)
+            if align is not None and 0 <= n + align and old[n + align:n + align + GRAM] == gram:
+                o = n + align
+            else:
+                o = index.get(gram)
+        if o is None:
+            insert.append(new[n])
+            n += 1
+            continue
+        if insert:
+            ops += bytes([OP_INSERT]) + _varint(len(insert)) + insert
+            insert = bytearray()
+        length = _extend(old, new, o, n)
+        if o != old_pos:
+            ops += bytes([OP_SEEK]) + _varint(_zigzag(o - old_pos))
+        _emit_region(ops, old, new, o, n, length)
+        old_pos = o + length
+        align = o - n
+        n += length
+    if insert:
+        ops += bytes([OP_INSERT]) + _varint(len(insert)) + insert
+    ops.append(OP_END)
+
+    header = HEADER.pack(MAGIC, len(old), len(new), hashlib.sha256(old).digest(), hashlib.sha256(new).digest())
+    return header + bytes(ops)
+
+
+def apply_patch(old, patch):
+    """reference applier (same logic as the device)"""
+    magic, old_size, new_size, old_sha, new_sha = HEADER.unpack_from(patch)
+    if magic != MAGIC:
+        raise ValueError("no delta patch")
+    if old_size != len(old) or hashlib.sha256(old).digest() != old_sha:
+        raise ValueError("patch does not match the old image")
+    out = bytearray()
+    pos = HEADER.size
+    old_pos = 0
+    while True:
+        op = patch[pos]
+        pos += 1
+        if op == OP_END:
+            break
+        arg, pos = _read_varint(patch, pos)
+        if op == OP_COPY:
+            out += old[old_pos:old_pos + arg]
+            old_pos += arg
+        elif op == OP_ADD:
+            out += bytes((a + b) & 0xFF for a, b in zip(old[old_pos:old_pos + arg], patch[pos:pos + arg]))
+            old_pos += arg
+            pos += arg
+        elif op == OP_INSERT:
+            out += patch[pos:pos + arg]
+            pos += arg
+        elif op == OP_SEEK:
+            old_pos += (arg >> 1) ^ -(arg & 1)
+        else:
+            raise ValueError("unknown op %d" % op)
+    if len(out) != new_size or hashlib.sha256(out).digest() != new_sha:
+        raise ValueError("result does not match the new image")
+    return bytes(out)
+
+
+def _modified(image, seed):
+    """simulate a new firmware version: insert code and relocate addresses behind it"""
+    rnd = random.Random(seed)
+    data = bytearray(image)
+    at = (len(data) // 2) & ~3
+    code = bytes(rnd.getrandbits(8) for _ in range(1024))
+    data[at:at] = code
+    # addresses in the flash mapped code and data regions behind the insertion move as well
+    for i in range(0, len(data) - 3, 4):
+        word = struct.unpack_from("<I", data, i)[0]
+        for base in (0x42000000, 0x3C000000):
+            if base + at <= word < base + 0x400000:
+                struct.pack_into("<I", data, i, word + len(code))
+    # some changed constants
+    for _ in range(20):
+        i = rnd.randrange(len(data))
+        data[i] = rnd.getrandbits(8)
+    return bytes(data)
+
+
+def selftest(path=None):
+    """round trip of patch creation and application"""
+    if path:
+        with open(path, "rb") as f:
+            old = f.read()
+    else:
+        rnd = random.Random(1)
+        old = bytes(rnd.getrandbits(8) for _ in range(200 * 1024))
+    cases = [
+        ("identical", old),
+        ("empty new image", b""),
+        ("new version", _modified(old, 2)),
+        ("unrelated", bytes(random.Random(3).getrandbits(8) for _ in range(4096))),
+    ]
+    ok = True
+    for name, new in cases:
+        start = time.time()
+        patch = create_patch(old, new)
+        ok_case = apply_patch(old, patch) == new
+        ok = ok and ok_case
+        print(
+            "%-16s %s  new: %8d bytes  patch: %8d bytes (%5.1f%%)  %.1f s"
+            % (name, "ok  " if ok_case else "FAIL", len(new), len(patch), len(patch) * 100.0 / max(1, len(new)), time.time() - start)
+        )
+    try:
+        apply_patch(old[:-1] + b"x", create_patch(old, cases[2][1]))
+        print("wrong old image  FAIL (not detected)")
+        ok = False
+    except ValueError:
+        print("wrong old image  ok   (rejected)")
+    return ok
+
+
+if __name__ == "__main__":
+    if len(sys.argv) == 5 and sys.argv[1] == "diff":
+        with open(sys.argv[2], "rb") as f_old, open(sys.argv[3], "rb") as f_new:
+            patch = create_patch(f_old.read(), f_new.read())
+        with open(sys.argv[4], "wb") as f:
+            f.write(patch)
+        print("patch: %d bytes" % len(patch))
+    elif len(sys.argv) == 5 and sys.argv[1] == "apply":
+        with open(sys.argv[2], "rb") as f_old, open(sys.argv[3], "rb") as f_patch:
+            new = apply_patch(f_old.read(), f_patch.read())
+        with open(sys.argv[4], "wb") as f:
+            f.write(new)
+        print("new image: %d bytes" % len(new))
+    elif len(sys.argv) in (2, 3) and sys.argv[1] == "selftest":
+        sys.exit(0 if selftest(sys.argv[2] if len(sys.argv) == 3 else None) else 1)
+    else:
+        print("usage: python scripts/delta_ota.py diff <old.bin> <new.bin> <patch.bin>")
+        print("       python scripts/delta_ota.py apply <old.bin> <patch.bin> <new.bin>")
+        print("       python scripts/delta_ota.py selftest [firmware.bin]")
+        sys.exit(1)
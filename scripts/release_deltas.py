@@ -0,0 +1,95 @@
+# Delta OTA images from the previous GitHub releases to the current build
+#
+# usage: python scripts/release_deltas.py <firmware.bin> <version> <release dir> [history dir]
+#        pio run -t release_deltas  (scripts/build_release.py)
+#
+# - the ota images of the last DELTA_BASES published releases are downloaded once into
+#   the history folder (named exactly like the release assets, e.g.
+#   esp32_webui_ota_update_v1.0.0.bin) - local builds are never stored there
+# - for every base a compressed patch <DELTA_NAME>_<old tag>_to_<version>.bin is created,
+#   the device selects it by "_delta_<VERSION>_to_" (ghDeltaAsset in src/github.cpp)
+# - a delta is only valid for the exact image of the old release (the device checks its sha256)
+import json
+import os
+import re
+import shutil
+import sys
+import urllib.request
+from datetime import datetime, timezone
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import compress_ota
+import delta_ota
+
+
+OTA_NAME = "esp32_webui_ota_update"        # prefix for ota release image
+DELTA_NAME = "esp32_webui_ota_delta"       # prefix for delta ota images (patch from an older release)
+DELTA_BASES = 3                            # number of previous releases with a delta image
+GITHUB_REPO = "dewenni/EspWebUI-Template"  # previous ota images are downloaded from its releases
+
+
+# name of the ota image of a release - version is the tag as published (e.g. "v1.0.0")
+def ota_name(version):
+    return f"{OTA_NAME}_{version}.bin"
+
+# name of the delta image from release old_version to version
+def delta_name(old_version, version):
+    return f"{DELTA_NAME}_{old_version}_to_{version}.bin"
+
+# download the ota images of the last DELTA_BASES releases that are not in the history
+def fetch_history(history_path, version):
+    headers = {"Accept": "application/vnd.github+json", "User-Agent": "release_deltas.py"}
+    if os.environ.get("GITHUB_TOKEN"):
+        headers["Authorization"] = "Bearer " + os.environ["GITHUB_TOKEN"]
+    try:
+        url = f"https://api.github.com/repos/{GITHUB_REPO}/releases?per_page={DELTA_BASES + 1}"
+        with urllib.request.urlopen(urllib.request.Request(url, headers=headers), timeout=30) as response:
+            releases = [r for r in json.load(response) if not r.get("draft") and r["tag_name"] != version][:DELTA_BASES]
+        for release in releases:
+            old_version = release["tag_name"]
+            target = os.path.join(history_path, ota_name(old_version))
+            assets = [a for a in release["assets"] if a["name"] == ota_name(old_version)]
+            if os.path.exists(target) or not assets:
+                continue
+            request = urllib.request.Request(assets[0]["browser_download_url"], headers={"User-Agent": headers["User-Agent"]})
+            with urllib.request.urlopen(request, timeout=60) as response, open(target + ".tmp", "wb") as f:
+                shutil.copyfileobj(response, f)
+            os.replace(target + ".tmp", target)
+            # the release date is the age of the base (newest bases are used)
+            published = datetime.strptime(release["published_at"], "%Y-%m-%dT%H:%M:%SZ").replace(tzinfo=timezone.utc).timestamp()
+            os.utime(target, (published, published))
+            print(f"delta base {old_version}: downloaded from the GitHub release")
+    except (OSError, ValueError, KeyError) as e:
+        print(f"no delta base downloaded ({e}) - delta images only for the releases in {history_path}")
+
+# create delta images from the last DELTA_BASES releases to the current one
+def create_deltas(app_file, version, release_path, history_path):
+    os.makedirs(history_path, exist_ok=True)
+    fetch_history(history_path, version)
+    with open(app_file, "rb") as f:
+        new_image = f.read()
+
+    bases = []
+    for name in os.listdir(history_path):
+        match = re.match(rf"{OTA_NAME}_(.+)\.bin$", name)
+        if match and match.group(1) != version:
+            bases.append((os.path.getmtime(os.path.join(history_path, name)), match.group(1), name))
+    files = []
+    for _, old_version, name in sorted(bases, reverse=True)[:DELTA_BASES]:
+        with open(os.path.join(history_path, name), "rb") as f:
+            patch = compress_ota.compress(delta_ota.create_patch(f.read(), new_image))
+        delta_file = os.path.join(release_path, delta_name(old_version, version))
+        with open(delta_file, "wb") as f:
+            f.write(patch)
+        files.append(delta_file)
+        print(f"delta {old_version} -> {version}: {len(patch)} bytes ({len(patch) * 100 / len(new_image):.1f}% of {len(new_image)} bytes)")
+    return files
+
+
+if __name__ == "__main__":
+    if len(sys.argv) not in (4, 5):
+        print("usage: python scripts/release_deltas.py <firmware.bin> <version> <release dir> [history dir]")
+        sys.exit(1)
+    history = sys.argv[4] if len(sys.argv) == 5 else os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "release_history")
+    os.makedirs(sys.argv[3], exist_ok=True)
+    create_deltas(sys.argv[1], sys.argv[2], sys.argv[3], history)
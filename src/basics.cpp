@@ -1,6 +1,9 @@
 #include <ETH.h>
 #include <SPI.h>
 #include <basics.h>
+#include <jsonArena.h>
+#include <metrics.h>
+#include <scheduler.h>
 
 #ifndef ETH_PHY_TYPE
 #define ETH_PHY_TYPE ETH_PHY_W5500
@@ -20,6 +23,7 @@ SPIClass *SPI_2;
 static muTimer wifiReconnectTimer = muTimer(); // timer for reconnect delay
 static int wifi_retry = 0;
 static const char *TAG = "SETUP"; // LOG TAG
+static JsonArena infoArena("mqttinfo", 2048); // JSON memory for wifi, eth, sysinfo and perf messages
 
 /**
  * *******************************************************************
@@ -257,9 +261,7 @@ void refreshNetworkInfo() {
  * *******************************************************************/
 void sendWiFiInfo() {
 
-  refreshNetworkInfo();
-
-  JsonDocument wifiJSON;
+  JsonDocument wifiJSON(&infoArena);
 
   if (wifi.connected) {
     wifiJSON["status"] = wifi.connected ? "connected" : "disconnected";
@@ -291,9 +293,7 @@ void sendWiFiInfo() {
  * *******************************************************************/
 void sendETHInfo() {
 
-  refreshNetworkInfo();
-
-  JsonDocument ethJSON;
+  JsonDocument ethJSON(&infoArena);
   ethJSON["ip"] = eth.ipAddress;
   ethJSON["status"] = eth.connected ? "connected" : "disconnected";
   ethJSON["link_up"] = eth.linkUp ? "active" : "inactive";
@@ -316,18 +316,15 @@ void sendETHInfo() {
  * *******************************************************************/
 void sendSysInfo() {
 
-  // Uptime and restart reason
-  char uptimeStr[64];
-  getUptime(uptimeStr, sizeof(uptimeStr));
   // ESP Heap and Flash usage
   char heap[10];
-  snprintf(heap, sizeof(heap), "%.1f %%", (float)(ESP.getHeapSize() - ESP.getFreeHeap()) * 100 / ESP.getHeapSize());
+  snprintf(heap, sizeof(heap), "%.1f %%", metrics.heapUsage);
   char flash[10];
-  snprintf(flash, sizeof(flash), "%.1f %%", (float)ESP.getSketchSize() * 100 / ESP.getFreeSketchSpace());
+  snprintf(flash, sizeof(flash), "%.1f %%", metrics.flashUsage);
 
-  JsonDocument sysInfoJSON;
-  sysInfoJSON["uptime"] = uptimeStr;
-  sysInfoJSON["restart_reason"].set((char *)EspSysUtil::RestartReason::get());
+  JsonDocument sysInfoJSON(&infoArena);
+  sysInfoJSON["uptime"] = metrics.uptime;
+  sysInfoJSON["restart_reason"] = metrics.restartReason;
   sysInfoJSON["heap"] = heap;
   sysInfoJSON["flash"] = flash;
   sysInfoJSON["sw_version"] = VERSION;
@@ -336,6 +333,40 @@ void sendSysInfo() {
   mqttPublish(addTopic("/sysinfo"), sendInfoJSON, false);
 }
 
+/**
+ * *******************************************************************
+ * @brief   add run time statistics of one task to JSON object
+ * @param   obj JSON object
+ * @param   hist run time histogram
+ * @return  none
+ * *******************************************************************/
+static void addPerfInfo(JsonObject obj, const s_schedhist &hist) {
+  obj["n"] = hist.count;
+  obj["min"] = hist.minUs;
+  obj["p50"] = schedPercentile(hist, 50);
+  obj["p99"] = schedPercentile(hist, 99);
+  obj["max"] = hist.maxUs;
+}
+
+/**
+ * *******************************************************************
+ * @brief   build loop performance structure and send it via mqtt
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+void sendPerfInfo() {
+
+  JsonDocument perfJSON(&infoArena);
+  addPerfInfo(perfJSON["loop"].to<JsonObject>(), *schedLoopHist());
+  for (int i = 0; i < schedTaskCount(); i++) {
+    const s_schedtask *t = schedGetTask(i);
+    addPerfInfo(perfJSON[t->name].to<JsonObject>(), t->hist);
+  }
+  char sendPerfJSON[1024] = {'\0'};
+  serializeJson(perfJSON, sendPerfJSON);
+  mqttPublish(addTopic("/perf"), sendPerfJSON, false);
+}
+
 /**
  * *******************************************************************
  * @brief   generate uptime message
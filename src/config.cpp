@@ -3,6 +3,7 @@
 #include <LittleFS.h>
 #include <basics.h>
 #include <config.h>
+#include <jsonArena.h>
 #include <message.h>
 
 /* D E C L A R A T I O N S ****************************************************/
@@ -14,8 +15,8 @@ bool setupMode;
 bool configInitDone = false;
 unsigned long hashOld;
 s_config config;
-muTimer checkTimer = muTimer(); // timer to refresh other values
 static const char *TAG = "CFG"; // LOG TAG
+static JsonArena configArena("config", 4096); // JSON memory for load and save
 char encrypted[256] = {0};
 char decrypted[128] = {0};
 const unsigned char key[16] = {0x6d, 0x79, 0x5f, 0x73, 0x65, 0x63, 0x75, 0x72, 0x65, 0x5f, 0x6b, 0x65, 0x79, 0x31, 0x32, 0x33};
@@ -64,7 +65,7 @@ void configHashInit() {
  * *******************************************************************/
 void configCyclic() {
 
-  if (checkTimer.cycleTrigger(1000) && configInitDone) {
+  if (configInitDone) {
     unsigned long hashNew = EspStrUtil::hash(&config, sizeof(s_config));
     if (hashNew != hashOld) {
       hashOld = hashNew;
@@ -85,6 +86,11 @@ void configInitValue() {
 
   // Logger
   config.log.level = 4;
+  config.log.mqtt_level = 2;
+
+  // Syslog
+  config.syslog.port = 514;
+  config.syslog.level = 3;
 
   // WiFi
   config.wifi.enable = true;
@@ -113,7 +119,7 @@ void configInitValue() {
  * *******************************************************************/
 void configSaveToFile() {
 
-  JsonDocument doc; // reserviert 2048 Bytes für das JSON-Objekt
+  JsonDocument doc(&configArena);
 
   doc["version"] = CFG_VERSION;
 
@@ -176,6 +182,16 @@ void configSaveToFile() {
   doc["logger"]["enable"] = config.log.enable;
   doc["logger"]["level"] = config.log.level;
   doc["logger"]["order"] = config.log.order;
+  doc["logger"]["mqtt_enable"] = config.log.mqtt_enable;
+  doc["logger"]["mqtt_level"] = config.log.mqtt_level;
+  for (int i = 0; i < LOG_LEVEL_TAGS; i++) {
+    doc["logger"]["tag_level"][logLevelTags[i]] = config.log.tag_level[i];
+  }
+
+  doc["syslog"]["enable"] = config.syslog.enable;
+  doc["syslog"]["server"] = config.syslog.server;
+  doc["syslog"]["port"] = config.syslog.port;
+  doc["syslog"]["level"] = config.syslog.level;
 
   // Delete existing file, otherwise the configuration is appended to the file
   LittleFS.remove(filename);
@@ -209,7 +225,7 @@ void configLoadFromFile() {
   File file = LittleFS.open(filename);
 
   // Allocate a temporary JsonDocument
-  JsonDocument doc;
+  JsonDocument doc(&configArena);
 
   // Deserialize the JSON document
   DeserializationError error = deserializeJson(doc, file);
@@ -294,6 +310,16 @@ void configLoadFromFile() {
   config.log.enable = doc["logger"]["enable"];
   config.log.level = doc["logger"]["level"];
   config.log.order = doc["logger"]["order"];
+  config.log.mqtt_enable = doc["logger"]["mqtt_enable"];
+  config.log.mqtt_level = doc["logger"]["mqtt_level"] | 2;
+  for (int i = 0; i < LOG_LEVEL_TAGS; i++) {
+    config.log.tag_level[i] = doc["logger"]["tag_level"][logLevelTags[i]];
+  }
+
+  config.syslog.enable = doc["syslog"]["enable"];
+  EspStrUtil::readJSONstring(config.syslog.server, sizeof(config.syslog.server), doc["syslog"]["server"]);
+  config.syslog.port = doc["syslog"]["port"] | 514;
+  config.syslog.level = doc["syslog"]["level"] | 3;
 
   file.close();     // Close the file (Curiously, File's destructor doesn't close the file)
   configHashInit(); // init hash value
@@ -1,62 +1,406 @@
 #include <Arduino.h>
 
+#include <ArduinoJson.h>
+#include <config.h>
+#include <esp_crt_bundle.h>
+#include <esp_http_client.h>
 #include <github.h>
 #include <message.h>
+#include <otaDelta.h>
+#include <otaWriter.h>
 
 #define GITHUB_OWNER "dewenni"
 #define GITHUB_REPO "EspWebUI-Template"
+#define GITHUB_API_URL "https://api.github.com/repos/" GITHUB_OWNER "/" GITHUB_REPO "/releases/latest"
+#define GITHUB_READ_CHUNK 1436               // read size of the download (one TCP segment)
+#define GITHUB_TX_BUFFER 2048                // request buffer (the signed url of the asset storage is longer than the 512 byte default)
+#define GITHUB_MAX_REDIRECTS 3               // github.com redirects to the asset storage
+#define GITHUB_TIMEOUT_MS 10000              // network timeout of the download
+#define GITHUB_CHECK_TTL_MS (15 * 60 * 1000) // cached release is used without request for this time
+#define GITHUB_CHECK_STACK 8192              // stack size of the check task (TLS handshake)
+#define GITHUB_CHECK_PRIO 1                  // priority of the check task (same as loop)
+#define GITHUB_ETAG_LEN 80                   // max length of the ETag (W/"<sha256>")
 
 static const char *TAG = "GITHUB"; // LOG TAG
 
-GithubReleaseOTA ota(GITHUB_OWNER, GITHUB_REPO);
+s_ghcheckstat ghCheckStat;
+static void (*progressCallback)(int) = NULL;
 
-void ghSetProgressCallback(void (*callback)(int)) { ota.setProgressCallback(callback); }
+// result of the last release check (written by the check task, read by the loop)
+struct s_ghcache {
+  bool valid;                 // info contains a release
+  GithubReleaseInfo info;     // latest release
+  char etag[GITHUB_ETAG_LEN]; // ETag of the response (If-None-Match of the next request)
+  uint32_t fetchedMs;         // time of the last successful request
+};
+static s_ghcache cache;
+static portMUX_TYPE cacheMux = portMUX_INITIALIZER_UNLOCKED;
+static bool checkRunning = false; // check task is running
+static bool checkDone = false;    // check task has finished - result not yet reported
+static char responseEtag[GITHUB_ETAG_LEN];
 
-bool ghGetLatestRelease(GithubRelease *release, GithubReleaseInfo *info) {
+// ArduinoJson reader for the response body (no buffer for the whole body)
+struct s_ghreader {
+  esp_http_client_handle_t client;
+  char buf[256];
+  int len = 0;
+  int pos = 0;
+  int read() {
+    if (pos >= len) {
+      len = esp_http_client_read(client, buf, sizeof(buf));
+      pos = 0;
+      if (len <= 0) {
+        return -1;
+      }
+    }
+    return (uint8_t)buf[pos++];
+  }
+  size_t readBytes(char *dst, size_t n) {
+    size_t i = 0;
+    for (int c; i < n && (c = read()) >= 0; i++) {
+      dst[i] = c;
+    }
+    return i;
+  }
+};
 
-  if (release == nullptr || info == nullptr) {
-    return false;
+void ghSetProgressCallback(void (*callback)(int)) { progressCallback = callback; }
+
+/**
+ * *******************************************************************
+ * @brief   search the delta patch from the installed version
+ * @param   assets assets of the release
+ * @return  name of the asset or NULL
+ * *******************************************************************/
+static const char *ghDeltaAsset(JsonArrayConst assets) {
+  char pattern[48];
+  snprintf(pattern, sizeof(pattern), "_delta_%s_to_", VERSION);
+  for (JsonVariantConst asset : assets) {
+    const char *name = asset["name"];
+    if (name != NULL && strstr(name, pattern) != NULL) {
+      return name;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * *******************************************************************
+ * @brief   search the complete firmware image (compressed if available)
+ * @param   assets assets of the release
+ * @return  name of the asset or NULL
+ * *******************************************************************/
+static const char *ghFullAsset(JsonArrayConst assets) {
+  const char *image = NULL;
+  for (JsonVariantConst asset : assets) {
+    const char *name = asset["name"];
+    if (name == NULL || strstr(name, "ota") == NULL || strstr(name, "_delta_") != NULL) {
+      continue;
+    }
+    if (strstr(name, "_ota_compressed_") != NULL) {
+      return name;
+    }
+    if (image == NULL) {
+      image = name;
+    }
+  }
+  return image;
+}
+
+/**
+ * *******************************************************************
+ * @brief   collect the ETag of the response
+ * *******************************************************************/
+static esp_err_t ghHttpEvent(esp_http_client_event_t *evt) {
+  if (evt->event_id == HTTP_EVENT_ON_HEADER && strcasecmp(evt->header_key, "ETag") == 0) {
+    snprintf(responseEtag, sizeof(responseEtag), "%s", evt->header_value);
+  }
+  return ESP_OK;
+}
+
+/**
+ * *******************************************************************
+ * @brief   request the latest release from the GitHub API
+ * @param   etag ETag of the cached release ("" = no cache)
+ * @param   info latest release (only if HTTP 200)
+ * @return  HTTP status (304 = cached release is still valid) or -1
+ * *******************************************************************/
+static int ghFetchLatestRelease(const char *etag, GithubReleaseInfo *info) {
+
+  esp_http_client_config_t cfg = {};
+  cfg.url = GITHUB_API_URL;
+  cfg.timeout_ms = GITHUB_TIMEOUT_MS;
+  cfg.crt_bundle_attach = esp_crt_bundle_attach;
+  cfg.event_handler = ghHttpEvent;
+
+  esp_http_client_handle_t client = esp_http_client_init(&cfg);
+  if (client == NULL) {
+    return -1;
+  }
+  esp_http_client_set_header(client, "Accept", "application/vnd.github+json");
+  if (etag[0] != '\0') {
+    // 304 saves the body - the request still counts against the rate limit (free only for authenticated requests)
+    esp_http_client_set_header(client, "If-None-Match", etag);
+  }
+  responseEtag[0] = '\0';
+
+  int status = -1;
+  if (esp_http_client_open(client, 0) == ESP_OK && esp_http_client_fetch_headers(client) >= 0) {
+    status = esp_http_client_get_status_code(client);
+  }
+  if (status == 200) {
+    // only the needed fields are kept - the release notes can be several KB
+    JsonDocument filter;
+    filter["tag_name"] = true;
+    filter["html_url"] = true;
+    filter["assets"][0]["name"] = true;
+    JsonDocument doc;
+    s_ghreader reader;
+    reader.client = client;
+    DeserializationError error = deserializeJson(doc, reader, DeserializationOption::Filter(filter));
+    const char *tag = doc["tag_name"];
+    const char *url = doc["html_url"];
+    if (error || tag == NULL || url == NULL) {
+      ESP_LOGE(TAG, "invalid release data: %s", error.c_str());
+      status = -1;
+    } else {
+      JsonArrayConst assets = doc["assets"];
+      const char *delta = ghDeltaAsset(assets);
+      const char *full = ghFullAsset(assets);
+      memset(info, 0, sizeof(GithubReleaseInfo));
+      snprintf(info->tag, sizeof(info->tag), "%s", tag);
+      snprintf(info->url, sizeof(info->url), "%s", url);
+      // prefer a delta patch from the installed version, otherwise the (compressed) image that contains "ota" in its name
+      snprintf(info->asset, sizeof(info->asset), "%s", delta ? delta : (full ? full : ""));
+      snprintf(info->fallback, sizeof(info->fallback), "%s", (delta && full) ? full : "");
+    }
+  }
+  esp_http_client_cleanup(client);
+  return status;
+}
+
+/**
+ * *******************************************************************
+ * @brief   check task: request the latest release and update the cache
+ * @param   param unused
+ * @return  none
+ * *******************************************************************/
+static void ghCheckTask(void *param) {
+  GithubReleaseInfo info;
+  char etag[GITHUB_ETAG_LEN];
+  uint32_t start = millis();
+
+  portENTER_CRITICAL(&cacheMux);
+  strcpy(etag, cache.valid ? cache.etag : "");
+  portEXIT_CRITICAL(&cacheMux);
+
+  int status = ghFetchLatestRelease(etag, &info);
+
+  portENTER_CRITICAL(&cacheMux);
+  if (status == 200) {
+    cache.info = info;
+    strcpy(cache.etag, responseEtag);
+    cache.valid = true;
+    cache.fetchedMs = millis();
+  } else if (status == 304 && cache.valid) {
+    cache.fetchedMs = millis();
   }
+  checkDone = true;
+  checkRunning = false;
+  portEXIT_CRITICAL(&cacheMux);
 
-  // Get the latest release from GitHub
-  *release = ota.getLatestRelease();
+  ghCheckStat.requests++;
+  ghCheckStat.lastMs = millis() - start;
+  if (status == 304) {
+    ghCheckStat.notModified++;
+  } else if (status != 200) {
+    ghCheckStat.errors++;
+  }
+  ESP_LOGI(TAG, "release check: HTTP %d in %" PRIu32 " ms", status, ghCheckStat.lastMs);
+  vTaskDelete(NULL);
+}
+
+/**
+ * *******************************************************************
+ * @brief   request the latest release
+ * @details the HTTPS request runs in a separate task, so the loop is not
+ *          blocked. A result younger than GITHUB_CHECK_TTL_MS is used
+ *          without request, an older one is refreshed in the background.
+ *          The TTL limits the requests to the API (60 per hour without
+ *          authentication, a 304 included).
+ * @param   none
+ * @return  true if a cached release can be shown now
+ * *******************************************************************/
+bool ghRequestLatestRelease() {
+  portENTER_CRITICAL(&cacheMux);
+  bool valid = cache.valid;
+  bool fresh = valid && (millis() - cache.fetchedMs < GITHUB_CHECK_TTL_MS);
+  bool start = !fresh && !checkRunning;
+  if (start) {
+    checkRunning = true;
+  }
+  portEXIT_CRITICAL(&cacheMux);
 
-  if (release->tag_name == nullptr || release->html_url == nullptr) {
+  if (fresh) {
+    ghCheckStat.cacheHits++;
+  }
+  if (start && xTaskCreate(ghCheckTask, "ghCheck", GITHUB_CHECK_STACK, NULL, GITHUB_CHECK_PRIO, NULL) != pdPASS) {
+    ESP_LOGE(TAG, "check task failed");
+    portENTER_CRITICAL(&cacheMux);
+    checkRunning = false;
+    checkDone = true; // report the error
+    portEXIT_CRITICAL(&cacheMux);
+  }
+  return valid;
+}
+
+/**
+ * *******************************************************************
+ * @brief   check if a release check has finished since the last call
+ * @param   none
+ * @return  true once per finished check
+ * *******************************************************************/
+bool ghReleaseCheckDone() {
+  portENTER_CRITICAL(&cacheMux);
+  bool done = checkDone;
+  checkDone = false;
+  portEXIT_CRITICAL(&cacheMux);
+  return done;
+}
+
+/**
+ * *******************************************************************
+ * @brief   get the cached latest release
+ * @param   info latest release
+ * @return  false if no release with an OTA asset is known
+ * *******************************************************************/
+bool ghGetLatestRelease(GithubReleaseInfo *info) {
+  if (info == nullptr) {
+    return false;
+  }
+  portENTER_CRITICAL(&cacheMux);
+  bool valid = cache.valid;
+  if (valid) {
+    *info = cache.info;
+  }
+  portEXIT_CRITICAL(&cacheMux);
+
+  if (!valid || info->asset[0] == '\0') {
     return false;
   }
+  return true;
+}
+
+/**
+ * *******************************************************************
+ * @brief   download firmware and pass it to the pipelined OTA writer
+ * @param   url download url of the asset
+ * @return  OTA_SUCCESS or error code of GithubReleaseOTA
+ * *******************************************************************/
+static int ghDownloadFirmware(const char *url) {
 
-  snprintf(info->tag, sizeof(info->tag), "%s", release->tag_name);
-  snprintf(info->url, sizeof(info->url), "%s", release->html_url);
-  ESP_LOGI(TAG, "GitHb latest Release: %s", info->tag);
+  esp_http_client_config_t cfg = {};
+  cfg.url = url;
+  cfg.timeout_ms = GITHUB_TIMEOUT_MS;
+  cfg.buffer_size = GITHUB_READ_CHUNK;
+  cfg.buffer_size_tx = GITHUB_TX_BUFFER;
+  cfg.max_redirection_count = GITHUB_MAX_REDIRECTS;
+  cfg.crt_bundle_attach = esp_crt_bundle_attach;
+
+  esp_http_client_handle_t client = esp_http_client_init(&cfg);
+  if (client == NULL) {
+    return OTA_CONNECT_ERROR;
+  }
 
-  // search for the first asset that contains "ota" in its name
-  const char *otaAssetName = NULL;
-  for (const auto &asset : release->assets) {
-    if (asset.name != NULL && strstr(asset.name, "ota") != NULL) {
-      otaAssetName = asset.name;
+  // follow redirects manually - the body is read as stream
+  int64_t length = -1;
+  int status = 0;
+  for (int i = 0; i <= GITHUB_MAX_REDIRECTS; i++) {
+    if (esp_http_client_open(client, 0) != ESP_OK) {
       break;
     }
+    length = esp_http_client_fetch_headers(client);
+    status = esp_http_client_get_status_code(client);
+    if (status < 300 || status >= 400) {
+      break;
+    }
+    esp_http_client_flush_response(client, NULL);
+    esp_http_client_set_redirection(client);
+  }
+  if (status != 200) {
+    ESP_LOGE(TAG, "download failed: HTTP %d", status);
+    esp_http_client_cleanup(client);
+    return OTA_CONNECT_ERROR;
   }
 
-  // copy the asset name to the info struct
-  if (otaAssetName != NULL) {
-    ESP_LOGI(TAG, "OTA Asset found: %s", otaAssetName);
-    snprintf(info->asset, sizeof(info->asset), "%s", otaAssetName);
-    return true;
-  } else {
-    ESP_LOGE(TAG, "No OTA Asset found!");
-    return false;
+  if (!otaStreamBegin(length > 0 ? length : 0)) {
+    esp_http_client_cleanup(client);
+    return OTA_BEGIN_ERROR;
   }
+
+  // receive the next chunk while the writer task flashes the previous one
+  static char buf[GITHUB_READ_CHUNK];
+  int result = OTA_SUCCESS;
+  int lastProgress = -1;
+  int64_t received = 0;
+  while (true) {
+    int len = esp_http_client_read(client, buf, sizeof(buf));
+    if (len < 0) {
+      result = OTA_CONNECT_ERROR;
+      break;
+    }
+    if (len == 0) {
+      if (!esp_http_client_is_complete_data_received(client)) {
+        result = OTA_CONNECT_ERROR;
+      }
+      break;
+    }
+    if (!otaStreamWrite((const uint8_t *)buf, len)) {
+      result = OTA_WRITE_ERROR;
+      break;
+    }
+    received += len;
+    int progress = length > 0 ? (int)(received * 100 / length) : 0;
+    if (progressCallback != NULL && progress != lastProgress) {
+      progressCallback(progress);
+      lastProgress = progress;
+    }
+  }
+  esp_http_client_cleanup(client);
+
+  if (result != OTA_SUCCESS) {
+    otaStreamAbort();
+    return result;
+  }
+  return otaStreamEnd() ? OTA_SUCCESS : OTA_END_ERROR;
 }
 
-int ghStartOtaUpdate(GithubRelease release, const char *asset) {
-  int result = ota.flashFirmware(release, asset);
+/**
+ * *******************************************************************
+ * @brief   update firmware with an asset of a GitHub release
+ * @param   info release and asset (see ghGetLatestRelease)
+ * @return  OTA_SUCCESS or error code of GithubReleaseOTA
+ * *******************************************************************/
+int ghStartOtaUpdate(const GithubReleaseInfo &info) {
+  int result = OTA_NULL_URL;
+
+  if (info.tag[0] != '\0' && info.asset[0] != '\0') {
+    char url[256];
+    snprintf(url, sizeof(url), "https://github.com/%s/%s/releases/download/%s/%s", GITHUB_OWNER, GITHUB_REPO, info.tag, info.asset);
+    result = ghDownloadFirmware(url);
 
-  if (result == 0) {
-    ESP_LOGI(TAG, "Firmware updated successfully");
+    // the installed firmware differs from the release (e.g. own build) - use the complete image
+    if (result != OTA_SUCCESS && otaDeltaStat.delta && info.fallback[0] != '\0') {
+      ESP_LOGW(TAG, "delta update failed (%s) - download complete image", otaStat.error ? otaStat.error : "error");
+      snprintf(url, sizeof(url), "https://github.com/%s/%s/releases/download/%s/%s", GITHUB_OWNER, GITHUB_REPO, info.tag, info.fallback);
+      result = ghDownloadFirmware(url);
+    }
+  }
+
+  if (result == OTA_SUCCESS) {
+    ESP_LOGI(TAG, "Firmware updated successfully (%" PRIu32 " KB/s, %" PRIu32 " ms)", otaStat.kbps, otaStat.durationMs);
   } else {
     ESP_LOGE(TAG, "Firmware update failed: %i", result);
-    ota.freeRelease(release);
   }
   return result;
-}
\ No newline at end of file
+}
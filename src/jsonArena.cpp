@@ -0,0 +1,143 @@
+#include <Arduino.h>
+#include <jsonArena.h>
+
+/* S E T T I N G S ****************************************************/
+#define JSON_ARENA_ALIGN 8 // alignment of all blocks
+
+// build flag JSON_ARENA_DISABLE: take all blocks from the heap (to compare heap fragmentation)
+
+/* D E C L A R A T I O N S ****************************************************/
+JsonArena *JsonArena::first = NULL;
+
+/**
+ * *******************************************************************
+ * @brief   align size to block alignment
+ * @param   size
+ * @return  aligned size
+ * *******************************************************************/
+static size_t alignSize(size_t size) { return (size + JSON_ARENA_ALIGN - 1) & ~(size_t)(JSON_ARENA_ALIGN - 1); }
+
+/**
+ * *******************************************************************
+ * @brief   constructor - add arena to the list of all arenas
+ * @param   name name of the use site (for reports)
+ * @param   size size of the arena buffer
+ * *******************************************************************/
+JsonArena::JsonArena(const char *name, size_t size) : name(name), size(alignSize(size)) {
+  portMUX_INITIALIZE(&mux);
+  next = first;
+  first = this;
+}
+
+/**
+ * *******************************************************************
+ * @brief   check if block is part of the arena buffer
+ * @param   ptr block
+ * @return  true if the block is part of the arena buffer
+ * *******************************************************************/
+bool JsonArena::inArena(const void *ptr) const {
+  return buffer != NULL && (const uint8_t *)ptr >= buffer && (const uint8_t *)ptr < buffer + size;
+}
+
+/**
+ * *******************************************************************
+ * @brief   allocate block
+ * @param   size
+ * @return  block (from arena buffer or heap)
+ * *******************************************************************/
+void *JsonArena::allocate(size_t size) {
+  size_t alignedSize = alignSize(size);
+
+#ifndef JSON_ARENA_DISABLE
+  if (buffer == NULL) {
+    uint8_t *block = (uint8_t *)malloc(this->size); // allocated once and never released
+    portENTER_CRITICAL(&mux);
+    if (buffer == NULL) {
+      buffer = block;
+      block = NULL;
+    }
+    portEXIT_CRITICAL(&mux);
+    free(block); // another task was faster
+  }
+#endif
+
+  portENTER_CRITICAL(&mux);
+#ifndef JSON_ARENA_DISABLE
+  if (buffer != NULL && used + alignedSize <= this->size) {
+    void *ptr = buffer + used;
+    last = used;
+    used += alignedSize;
+    live++;
+    if (used > highWater) {
+      highWater = used;
+    }
+    portEXIT_CRITICAL(&mux);
+    return ptr;
+  }
+#endif
+  fallbacks++;
+  portEXIT_CRITICAL(&mux);
+
+  return malloc(size);
+}
+
+/**
+ * *******************************************************************
+ * @brief   release block
+ * @param   ptr block
+ * @return  none
+ * *******************************************************************/
+void JsonArena::deallocate(void *ptr) {
+  if (!inArena(ptr)) {
+    free(ptr);
+    return;
+  }
+
+  // the buffer is reused when the last block has been released
+  portENTER_CRITICAL(&mux);
+  bool empty = (live > 0 && --live == 0);
+  if (empty) {
+    used = 0;
+    last = 0;
+  }
+  portEXIT_CRITICAL(&mux);
+}
+
+/**
+ * *******************************************************************
+ * @brief   resize block
+ * @details the last block of the arena buffer is resized in place
+ * @param   ptr block
+ * @param   newSize
+ * @return  resized block (NULL if no memory is available)
+ * *******************************************************************/
+void *JsonArena::reallocate(void *ptr, size_t newSize) {
+  if (ptr == NULL) {
+    return allocate(newSize);
+  }
+  if (!inArena(ptr)) {
+    return realloc(ptr, newSize);
+  }
+
+  size_t ofs = (uint8_t *)ptr - buffer;
+  size_t alignedSize = alignSize(newSize);
+  portENTER_CRITICAL(&mux);
+  if (ofs == last && ofs + alignedSize <= size) {
+    used = ofs + alignedSize;
+    if (used > highWater) {
+      highWater = used;
+    }
+    portEXIT_CRITICAL(&mux);
+    return ptr;
+  }
+
+  // move block - the old size is unknown, but it ends before "used"
+  size_t copySize = min(newSize, used - ofs);
+  portEXIT_CRITICAL(&mux);
+  void *newPtr = allocate(newSize);
+  if (newPtr != NULL) {
+    memcpy(newPtr, ptr, copySize);
+    deallocate(ptr);
+  }
+  return newPtr;
+}
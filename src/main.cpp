@@ -3,7 +3,10 @@
 #include <basics.h>
 #include <config.h>
 #include <message.h>
+#include <metrics.h>
 #include <mqtt.h>
+#include <mqttDiscovery.h>
+#include <scheduler.h>
 #include <telnet.h>
 #include <webUI.h>
 #include <webUIupdates.h>
@@ -11,7 +14,6 @@
 /* D E C L A R A T I O N S ****************************************************/
 static muTimer heartbeat = muTimer();      // timer for heartbeat signal
 static muTimer setupModeTimer = muTimer(); // timer for heartbeat signal
-static muTimer wdtTimer = muTimer();       // timer to reset wdt
 
 static EspSysUtil::MRD32 *mrd;  // Multi-Reset-Detector
 static bool main_reboot = true; // reboot flag
@@ -50,6 +52,9 @@ void setup() {
   // basic setup functions
   basicSetup();
 
+  // system metrics (static values are read only once)
+  metricsSetup();
+
   // Setup OTA
   ArduinoOTA.onStart([]() {
     ESP_LOGI(TAG, "OTA-started");
@@ -79,6 +84,40 @@ void setup() {
 
   // telnet Setup
   setupTelnet();
+
+  // register cyclic tasks (name, function, priority, period, time budget)
+  schedAdd(
+      "wdt",
+      []() {
+        if (wdt.isActive()) {
+          esp_task_wdt_reset();
+        }
+      },
+      0, 2000, 100);
+  schedAdd("ota", []() { ArduinoOTA.handle(); }, 0, SCHED_EVERY_LOOP, 2000);
+  schedAdd("mrd", []() { mrd->loop(); }, 1, SCHED_EVERY_LOOP, 500);
+  schedAdd("webui", webUICyclic, 1, SCHED_EVERY_LOOP, 5000);
+  schedAdd("message", messageCyclic, 2, SCHED_EVERY_LOOP, 2000);
+  schedAdd("telnet", cyclicTelnet, 2, SCHED_EVERY_LOOP, 2000);
+  schedAdd("config", configCyclic, 3, 1000, 20000);
+  schedAdd("metrics", metricsCyclic, 3, METRICS_SAMPLE_MS, 1000);
+  schedAdd(
+      "wifi",
+      []() {
+        if (!setupMode) {
+          checkWiFi();
+        }
+      },
+      3, SCHED_EVERY_LOOP, 1000);
+  schedAdd(
+      "mqtt",
+      []() {
+        if (config.mqtt.enable && !setupMode) {
+          mqttCyclic();
+        }
+      },
+      2, SCHED_EVERY_LOOP, 2000);
+  schedAdd("discovery", mqttDiscoveryCyclic, 4, SCHED_EVENT, 5000);
 }
 
 /**
@@ -89,39 +128,8 @@ void setup() {
  * *******************************************************************/
 void loop() {
 
-  // reset watchdog
-  if (wdt.isActive() && wdtTimer.cycleTrigger(2000)) {
-    esp_task_wdt_reset();
-  }
-
-  // OTA Update
-  ArduinoOTA.handle();
-
-  // double reset detector
-  mrd->loop();
-
-  // webUI Cyclic
-  webUICyclic();
-
-  // Message Service
-  messageCyclic();
-
-  // telnet communication
-  cyclicTelnet();
-
-  // check if config has changed
-  configCyclic();
-
-  // check WiFi - automatic reconnect
-  if (!setupMode) {
-    checkWiFi();
-  }
-
-  // check MQTT - automatic reconnect
-  if (config.mqtt.enable && !setupMode) {
-    mqttCyclic();
-  }
-
+  // run all due tasks
+  schedCyclic();
 
   main_reboot = false; // reset reboot flag
 }
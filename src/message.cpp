@@ -1,5 +1,6 @@
 #include <basics.h>
 #include <message.h>
+#include <syslogClient.h>
 #include <telnet.h>
 
 /* D E C L A R A T I O N S ****************************************************/
@@ -9,8 +10,38 @@ static const char *TAG = "MSG"; // LOG TAG
 s_logdata logData;
 esp_log_level_t logLevel = ESP_LOG_INFO;
 
+// log tags with adjustable log level (order must match config.log.tag_level)
+const char *logLevelTags[LOG_LEVEL_TAGS] = {"MAIN", "SETUP", "CFG", "WEB", "MQTT", "TELNET", "GITHUB", "SYSLOG", "MSG"};
+
+static char logTags[MAX_LOG_TAGS][MAX_LOG_TAG_LEN]; // tag table (index 0 = unknown tag)
+static int logTagCount = 1;
+static uint32_t logTagIdx[MAX_LOG_TAGS][LOG_IDX_WORDS];        // bitmap of buffer lines per tag
+static uint32_t logLevelIdx[ESP_LOG_VERBOSE + 1][LOG_IDX_WORDS]; // bitmap of buffer lines per log level
+
 static muTimer mainTimer = muTimer(); // timer for cyclic info
 
+// token bucket for rate limit of one log tag
+struct s_logbucket {
+  bool used;           // bucket has been filled on first use
+  uint32_t tokens;     // available tokens (x1000)
+  uint32_t lastMs;     // time of last refill
+  uint32_t suppressed; // suppressed messages since last report
+};
+static s_logbucket logBucket[MAX_LOG_TAGS];
+
+// last message for deduplication
+static char lastMsg[MAX_LOG_ENTRY];
+static esp_log_level_t lastLevel;
+static char lastTag[MAX_LOG_TAG_LEN];
+static uint32_t lastRepeat = 0;
+static uint32_t lastRepeatMs = 0;
+
+// protects tag table, rate limit and deduplication (ESP_LOG is called from any task)
+static portMUX_TYPE logMux = portMUX_INITIALIZER_UNLOCKED;
+
+/* P R O T O T Y P E S ********************************************************/
+static uint8_t logTagIndex(const char *tag);
+
 
 /**
  * *******************************************************************
@@ -35,6 +66,260 @@ void setLogLevel(uint8_t level) {
   }
   esp_log_level_set("*", logLevel);
   esp_log_level_set("ARDUINO", ESP_LOG_WARN);
+
+  // setting the global level resets all tag levels - so they have to be set again
+  for (int i = 0; i < LOG_LEVEL_TAGS; i++) {
+    if (config.log.tag_level[i] > 0) {
+      esp_log_level_set(logLevelTags[i], (esp_log_level_t)config.log.tag_level[i]);
+    }
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   set Log Level for one log tag
+ * @details the level is checked by esp_log_write() before the message
+ *          gets formatted, so suppressed messages cost almost nothing
+ * @param   tag log tag (one of logLevelTags)
+ * @param   level 1=error, 2=warning, 3=info, 4=debug, 0=global log level
+ * @return  false if tag or level is invalid
+ * *******************************************************************/
+bool setTagLogLevel(const char *tag, uint8_t level) {
+
+  if (level > ESP_LOG_DEBUG) {
+    return false;
+  }
+  for (int i = 0; i < LOG_LEVEL_TAGS; i++) {
+    if (strcasecmp(tag, logLevelTags[i]) == 0) {
+      config.log.tag_level[i] = level;
+      esp_log_level_set(logLevelTags[i], level > 0 ? (esp_log_level_t)level : logLevel);
+      ESP_LOGI(TAG, "LogLevel %s: %i", logLevelTags[i], level);
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * *******************************************************************
+ * @brief   extract log level and tag from ESP_LOG message header
+ * @param   msg message without timestamp, e.g. "W  MQTT: text"
+ * @param   level detected log level
+ * @param   tag buffer for detected tag
+ * @param   tagSize size of tag buffer
+ * @return  offset of message text (0 if header was not detected)
+ * *******************************************************************/
+static size_t parseLogHeader(const char *msg, esp_log_level_t *level, char *tag, size_t tagSize) {
+  const char *p = msg;
+
+  // skip color code
+  if (*p == '\033') {
+    const char *colorEnd = strchr(p, 'm');
+    if (colorEnd == NULL) {
+      return 0;
+    }
+    p = colorEnd + 1;
+  }
+
+  switch (*p) {
+  case 'E':
+    *level = ESP_LOG_ERROR;
+    break;
+  case 'W':
+    *level = ESP_LOG_WARN;
+    break;
+  case 'I':
+    *level = ESP_LOG_INFO;
+    break;
+  case 'D':
+    *level = ESP_LOG_DEBUG;
+    break;
+  case 'V':
+    *level = ESP_LOG_VERBOSE;
+    break;
+  default:
+    return 0;
+  }
+
+  p++;
+  while (*p == ' ') {
+    p++;
+  }
+  const char *sep = strstr(p, ": ");
+  if (sep == NULL || (size_t)(sep - p) >= tagSize) {
+    return 0;
+  }
+  memcpy(tag, p, sep - p);
+  tag[sep - p] = '\0';
+
+  return sep + 2 - msg;
+}
+
+/**
+ * *******************************************************************
+ * @brief   add a message that is generated by the logger itself
+ * @param   level log level
+ * @param   tag log tag
+ * @param   format, ...
+ * @return  none
+ * *******************************************************************/
+static void __attribute__((format(printf, 3, 4))) logInternal(esp_log_level_t level, const char *tag, const char *format, ...) {
+  static const char levelChar[] = {'N', 'E', 'W', 'I', 'D', 'V'};
+  char msg[MAX_LOG_ENTRY];
+  int ofs = snprintf(msg, sizeof(msg), "%c  %s: ", levelChar[level], tag);
+
+  va_list args;
+  va_start(args, format);
+  vsnprintf(msg + ofs, sizeof(msg) - ofs, format, args);
+  va_end(args);
+  strncat(msg, "\n", sizeof(msg) - strlen(msg) - 1);
+
+  addLogBuffer(msg, level, tag, ofs);
+  if (telnetIF.serialStream) {
+    telnetStream(msg);
+  }
+  printf("%s", msg);
+}
+
+/**
+ * *******************************************************************
+ * @brief   report number of repeated messages (if any)
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+static void logFlushRepeat() {
+  char tag[MAX_LOG_TAG_LEN];
+  portENTER_CRITICAL(&logMux);
+  uint32_t count = lastRepeat;
+  esp_log_level_t level = lastLevel;
+  memcpy(tag, lastTag, sizeof(tag));
+  lastRepeat = 0;
+  portEXIT_CRITICAL(&logMux);
+
+  if (count > 0) {
+    logInternal(level, tag, "last message repeated %" PRIu32 " times", count);
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   check if message is identical to the previous one
+ * @param   msg cleaned message
+ * @param   level log level
+ * @param   tag log tag
+ * @return  true if message is a repetition and should be suppressed
+ * *******************************************************************/
+static bool logIsRepeat(const char *msg, esp_log_level_t level, const char *tag) {
+  char prevTag[MAX_LOG_TAG_LEN];
+  portENTER_CRITICAL(&logMux);
+  if (strcmp(msg, lastMsg) == 0) {
+    if (lastRepeat == 0) {
+      lastRepeatMs = millis();
+    }
+    lastRepeat++;
+    logData.repeated++;
+    portEXIT_CRITICAL(&logMux);
+    return true;
+  }
+
+  // take over the repetitions of the previous message and remember the new one
+  uint32_t count = lastRepeat;
+  esp_log_level_t prevLevel = lastLevel;
+  memcpy(prevTag, lastTag, sizeof(prevTag));
+  lastRepeat = 0;
+  snprintf(lastMsg, sizeof(lastMsg), "%s", msg);
+  snprintf(lastTag, sizeof(lastTag), "%s", tag);
+  lastLevel = level;
+  portEXIT_CRITICAL(&logMux);
+
+  if (count > 0) {
+    logInternal(prevLevel, prevTag, "last message repeated %" PRIu32 " times", count);
+  }
+  return false;
+}
+
+/**
+ * *******************************************************************
+ * @brief   refill token bucket of a log tag (caller holds logMux)
+ * @param   bucket token bucket
+ * @param   now actual time in ms
+ * @return  none
+ * *******************************************************************/
+static void logRateRefill(s_logbucket *bucket, uint32_t now) {
+  uint32_t elapsed = min(now - bucket->lastMs, (uint32_t)(LOG_RATE_BURST * 1000UL));
+  bucket->tokens = min(bucket->tokens + elapsed * LOG_RATE_PER_SEC, (uint32_t)(LOG_RATE_BURST * 1000UL));
+  bucket->lastMs = now;
+}
+
+/**
+ * *******************************************************************
+ * @brief   check rate limit of log tag (token bucket)
+ * @param   tag log tag
+ * @return  true if message is accepted
+ * *******************************************************************/
+static bool logRateAccept(const char *tag) {
+  s_logbucket *bucket = &logBucket[logTagIndex(tag)];
+  uint32_t now = millis();
+
+  portENTER_CRITICAL(&logMux);
+  if (!bucket->used) {
+    // a new tag starts with a full burst
+    bucket->used = true;
+    bucket->tokens = LOG_RATE_BURST * 1000UL;
+    bucket->lastMs = now;
+  }
+
+  logRateRefill(bucket, now);
+  if (bucket->tokens < 1000) {
+    bucket->suppressed++;
+    logData.suppressed++;
+    portEXIT_CRITICAL(&logMux);
+    return false;
+  }
+  bucket->tokens -= 1000;
+  uint32_t count = bucket->suppressed;
+  bucket->suppressed = 0;
+  portEXIT_CRITICAL(&logMux);
+
+  // report suppressed messages before the next accepted one
+  if (count > 0) {
+    logInternal(ESP_LOG_WARN, tag, "%" PRIu32 " messages suppressed by rate limit", count);
+  }
+  return true;
+}
+
+/**
+ * *******************************************************************
+ * @brief   report suppressed messages of all tags whose bucket has refilled
+ * @details a tag that stops logging would otherwise never report its
+ *          suppressed messages (they are reported before the next
+ *          accepted message of the tag)
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+static void logRateFlush() {
+  uint32_t now = millis();
+  for (int i = 0; i < logTagCount; i++) {
+    if (logBucket[i].suppressed == 0) {
+      continue;
+    }
+    char tag[MAX_LOG_TAG_LEN];
+    uint32_t count = 0;
+    portENTER_CRITICAL(&logMux);
+    s_logbucket *bucket = &logBucket[i];
+    logRateRefill(bucket, now);
+    if (bucket->suppressed > 0 && bucket->tokens >= 1000) {
+      bucket->tokens -= 1000; // the report counts like a message of the tag
+      count = bucket->suppressed;
+      bucket->suppressed = 0;
+      memcpy(tag, logTags[i], sizeof(tag));
+    }
+    portEXIT_CRITICAL(&logMux);
+
+    if (count > 0) {
+      logInternal(ESP_LOG_WARN, tag, "%" PRIu32 " messages suppressed by rate limit", count);
+    }
+  }
 }
 
 /**
@@ -70,13 +355,23 @@ int custom_vprintf(const char *format, va_list args) {
     strncpy(cleaned_message, raw_message, sizeof(cleaned_message));
   }
 
+  // extract log level and tag from message header
+  esp_log_level_t level = ESP_LOG_INFO;
+  char tag[MAX_LOG_TAG_LEN] = {0};
+  size_t textOfs = parseLogHeader(cleaned_message, &level, tag, sizeof(tag));
+
+  // collapse repeated messages and limit bursts per tag
+  if (logIsRepeat(cleaned_message, level, tag) || !logRateAccept(tag)) {
+    va_end(args_copy);
+    return 0;
+  }
+
   // add to log buffer
-  addLogBuffer(cleaned_message);
+  addLogBuffer(cleaned_message, level, tag, textOfs);
 
-  // forward to telnet stream
+  // forward to telnet stream (written to the client in cyclicTelnet)
   if (telnetIF.serialStream) {
-    telnet.printf("%s", cleaned_message);
-    telnetShell();
+    telnetStream(cleaned_message);
   }
 
   // release copy of va_list
@@ -86,6 +381,115 @@ int custom_vprintf(const char *format, va_list args) {
 }
 
 
+/**
+ * *******************************************************************
+ * @brief   get index of log tag - unknown tags will be added to the table
+ * @param   tag
+ * @return  index of tag (0 if tag is empty or table is full)
+ * *******************************************************************/
+static uint8_t logTagIndex(const char *tag) {
+  if (tag == NULL || tag[0] == '\0') {
+    return 0;
+  }
+  uint8_t idx = 0;
+  portENTER_CRITICAL(&logMux);
+  for (int i = 1; i < logTagCount; i++) {
+    if (strcmp(logTags[i], tag) == 0) {
+      idx = i;
+      break;
+    }
+  }
+  if (idx == 0 && logTagCount < MAX_LOG_TAGS) {
+    snprintf(logTags[logTagCount], sizeof(logTags[logTagCount]), "%s", tag);
+    idx = logTagCount++;
+  }
+  portEXIT_CRITICAL(&logMux);
+  return idx;
+}
+
+/**
+ * *******************************************************************
+ * @brief   find log tag in the table without adding it
+ * @param   tag tag name (case-insensitive)
+ * @return  bitmask of all matching tag indices (0 if not found)
+ * *******************************************************************/
+static uint32_t logTagFind(const char *tag) {
+  uint32_t mask = 0;
+  for (int i = 1; i < logTagCount; i++) {
+    if (strcasecmp(logTags[i], tag) == 0) {
+      mask |= (1UL << i);
+    }
+  }
+  return mask;
+}
+
+/**
+ * *******************************************************************
+ * @brief   get name of log tag
+ * @param   idx index of tag
+ * @return  tag name
+ * *******************************************************************/
+const char *logTagName(uint8_t idx) { return (idx < logTagCount) ? logTags[idx] : ""; }
+
+/**
+ * *******************************************************************
+ * @brief   build tag bitmask from a list of tags
+ * @details the tags are compared case-insensitive with the tag table.
+ *          Tags that were never logged match no entry.
+ * @param   tagList comma separated list of tags e.g. "MQTT,WEB" ("*" = all)
+ * @return  bitmask of tag indices (0 = all tags)
+ * *******************************************************************/
+uint32_t logTagMask(const char *tagList) {
+  uint32_t mask = 0;
+  char tag[MAX_LOG_TAG_LEN];
+  const char *p = tagList;
+
+  while (p != NULL && *p != '\0') {
+    while (*p == ',' || *p == ' ') {
+      p++;
+    }
+    size_t len = strcspn(p, ", ");
+    if (len == 0) {
+      break;
+    }
+    if (len == 1 && *p == '*') {
+      return 0;
+    }
+    snprintf(tag, sizeof(tag), "%.*s", (int)len, p);
+    uint32_t found = logTagFind(tag);
+    mask |= found ? found : LOG_TAG_MASK_NONE;
+    p += len;
+  }
+  return mask;
+}
+
+/**
+ * *******************************************************************
+ * @brief   convert log level string to esp_log_level_t
+ * @param   str level as number (0-5) or name (E, W, I, D, V / error, warn, ...)
+ * @return  log level (ESP_LOG_VERBOSE if unknown)
+ * *******************************************************************/
+esp_log_level_t logLevelFromString(const char *str) {
+  if (isdigit(str[0])) {
+    int level = atoi(str);
+    return (esp_log_level_t)constrain(level, ESP_LOG_NONE, ESP_LOG_VERBOSE);
+  }
+  switch (toupper(str[0])) {
+  case 'N':
+    return ESP_LOG_NONE;
+  case 'E':
+    return ESP_LOG_ERROR;
+  case 'W':
+    return ESP_LOG_WARN;
+  case 'I':
+    return ESP_LOG_INFO;
+  case 'D':
+    return ESP_LOG_DEBUG;
+  default:
+    return ESP_LOG_VERBOSE;
+  }
+}
+
 /**
  * *******************************************************************
  * @brief   clear Logbuffer
@@ -93,7 +497,11 @@ int custom_vprintf(const char *format, va_list args) {
  * @return  none
  * *******************************************************************/
 void clearLogBuffer() {
-  logData.lastLine = 0;
+  portENTER_CRITICAL(&logMux);
+  logData.tail = logData.head;
+  memset(logTagIdx, 0, sizeof(logTagIdx));
+  memset(logLevelIdx, 0, sizeof(logLevelIdx));
+  portEXIT_CRITICAL(&logMux);
   for (int i = 0; i < MAX_LOG_LINES; i++) {
     memset(logData.buffer[i], 0, sizeof(logData.buffer[i]));
   }
@@ -102,14 +510,154 @@ void clearLogBuffer() {
 /**
  * *******************************************************************
  * @brief   add new entry to LogBuffer
- * @param   none
+ * @param   message cleaned message (without timestamp)
+ * @param   level log level of the message
+ * @param   tag log tag of the message
+ * @param   textOfs offset of the message text after the header
  * @return  none
  * *******************************************************************/
-void addLogBuffer(const char *message) {
-  if (strlen(message) != 0) {
-    snprintf(logData.buffer[logData.lastLine], sizeof(logData.buffer[logData.lastLine]), "[%s]  %s", EspStrUtil::getDateTimeString(), message);
-    logData.lastLine = (logData.lastLine + 1) % MAX_LOG_LINES; // update the lastLine index in a circular manner
+void addLogBuffer(const char *message, esp_log_level_t level, const char *tag, size_t textOfs) {
+  if (strlen(message) == 0) {
+    return;
   }
+
+  // format the entry outside the lock
+  char entry[MAX_LOG_ENTRY];
+  int prefix = snprintf(entry, sizeof(entry), "[%s]  ", EspStrUtil::getDateTimeString());
+  snprintf(entry + prefix, sizeof(entry) - prefix, "%s", message);
+
+  // remove line break at the end
+  size_t len = strlen(entry);
+  while (len > 0 && (entry[len - 1] == '\n' || entry[len - 1] == '\r')) {
+    entry[--len] = '\0';
+  }
+  uint8_t tagIdx = logTagIndex(tag);
+
+  // ring and index are written by every task that logs
+  portENTER_CRITICAL(&logMux);
+  int line = logData.head % MAX_LOG_LINES;
+  s_logmeta *meta = &logData.meta[line];
+  uint32_t bit = 1UL << (line % 32);
+
+  // remove overwritten entry from index
+  logTagIdx[meta->tag][line / 32] &= ~bit;
+  logLevelIdx[meta->level][line / 32] &= ~bit;
+
+  memcpy(logData.buffer[line], entry, len + 1);
+  meta->time = time(NULL);
+  meta->level = (level <= ESP_LOG_VERBOSE) ? level : ESP_LOG_VERBOSE;
+  meta->tag = tagIdx;
+  meta->text = min(prefix + textOfs, len);
+
+  // add new entry to index
+  logTagIdx[meta->tag][line / 32] |= bit;
+  logLevelIdx[meta->level][line / 32] |= bit;
+
+  logData.head++;
+  if (logData.head - logData.tail > MAX_LOG_LINES) {
+    logData.tail = logData.head - MAX_LOG_LINES;
+  }
+  portEXIT_CRITICAL(&logMux);
+}
+
+/**
+ * *******************************************************************
+ * @brief   get the first entry that is not older than the given time
+ * @param   t timestamp
+ * @return  sequence number of the entry (logData.head if none)
+ * *******************************************************************/
+static uint32_t logLowerBound(time_t t) {
+  uint32_t lo = logData.tail;
+  uint32_t hi = logData.head;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (logData.meta[mid % MAX_LOG_LINES].time < t) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+/**
+ * *******************************************************************
+ * @brief   query log entries that match the filter (oldest first)
+ * @param   filter tags, minimum level and time range
+ * @param   result buffer for sequence numbers of matching entries
+ * @param   maxCount size of result buffer
+ * @return  number of matching entries
+ * *******************************************************************/
+int logQuery(const s_logfilter &filter, uint32_t *result, int maxCount) {
+  uint32_t tagMask[LOG_IDX_WORDS] = {0};
+  uint32_t levelMask[LOG_IDX_WORDS] = {0};
+
+  // combine index bitmaps of all selected tags and levels
+  portENTER_CRITICAL(&logMux);
+  for (int t = 0; t < logTagCount; t++) {
+    if (filter.tags == 0 || (filter.tags & (1UL << t))) {
+      for (int w = 0; w < LOG_IDX_WORDS; w++) {
+        tagMask[w] |= logTagIdx[t][w];
+      }
+    }
+  }
+  for (int l = 0; l <= filter.level && l <= ESP_LOG_VERBOSE; l++) {
+    for (int w = 0; w < LOG_IDX_WORDS; w++) {
+      levelMask[w] |= logLevelIdx[l][w];
+    }
+  }
+  portEXIT_CRITICAL(&logMux);
+  for (int w = 0; w < LOG_IDX_WORDS; w++) {
+    tagMask[w] &= levelMask[w];
+  }
+
+  // entries are ordered by time - limit the range by binary search
+  uint32_t first = filter.from ? logLowerBound(filter.from) : logData.tail;
+  uint32_t last = filter.to ? logLowerBound(filter.to + 1) : logData.head;
+
+  int count = 0;
+  uint32_t seq = first;
+  while (seq < last && count < maxCount) {
+    int line = seq % MAX_LOG_LINES;
+    uint32_t word = tagMask[line / 32] >> (line % 32);
+    if (word == 0) {
+      // no match in the rest of this word
+      seq += min(32 - line % 32, MAX_LOG_LINES - line);
+      continue;
+    }
+    seq += __builtin_ctz(word);
+    if (seq < last) {
+      result[count++] = seq;
+    }
+    seq++;
+  }
+  return count;
+}
+
+/**
+ * *******************************************************************
+ * @brief   get text of log entry
+ * @param   seq sequence number of the entry
+ * @return  text of the entry ("" if the entry is no longer available)
+ * *******************************************************************/
+const char *logEntryText(uint32_t seq) {
+  if (seq < logData.tail || seq >= logData.head) {
+    return "";
+  }
+  return logData.buffer[seq % MAX_LOG_LINES];
+}
+
+/**
+ * *******************************************************************
+ * @brief   get meta information of log entry
+ * @param   seq sequence number of the entry
+ * @return  meta information (NULL if the entry is no longer available)
+ * *******************************************************************/
+const s_logmeta *logEntryMeta(uint32_t seq) {
+  if (seq < logData.tail || seq >= logData.head) {
+    return NULL;
+  }
+  return &logData.meta[seq % MAX_LOG_LINES];
 }
 
 /**
@@ -138,10 +686,22 @@ void messageSetup() {
  * *******************************************************************/
 void messageCyclic() {
 
+  // report repeated messages if no other message follows
+  if (lastRepeat > 0 && millis() - lastRepeatMs > LOG_REPEAT_FLUSH_MS) {
+    logFlushRepeat();
+  }
+
+  // report suppressed messages of tags that are quiet again
+  logRateFlush();
+
+  // forward log entries to syslog server
+  syslogCyclic();
+
   // send cyclic infos
   if (mainTimer.cycleTrigger(10000) && !setupMode && mqttIsConnected()) {
 
     sendSysInfo();
+    sendPerfInfo();
 
     if (config.wifi.enable) {
       sendWiFiInfo();
@@ -0,0 +1,90 @@
+#include <basics.h>
+#include <metrics.h>
+
+/* D E C L A R A T I O N S ****************************************************/
+s_metrics metrics;
+
+/**
+ * *******************************************************************
+ * @brief   sample dynamic values
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+static void metricsSample() {
+
+  uint32_t start = micros();
+
+  metrics.freeHeap = ESP.getFreeHeap();
+  metrics.maxAllocHeap = ESP.getMaxAllocHeap();
+  if (metrics.maxAllocHeapLow == 0 || metrics.maxAllocHeap < metrics.maxAllocHeapLow) {
+    metrics.maxAllocHeapLow = metrics.maxAllocHeap;
+  }
+  metrics.minFreeHeap = ESP.getMinFreeHeap();
+  metrics.heapUsage = (metrics.heapSize - metrics.freeHeap) * 100.0f / metrics.heapSize;
+  getUptime(metrics.uptime, sizeof(metrics.uptime));
+
+  // WiFi and ETH informations
+  refreshNetworkInfo();
+
+  metrics.samples++;
+  metrics.sampleUs = micros() - start;
+}
+
+/**
+ * *******************************************************************
+ * @brief   metrics setup - read static values once
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+void metricsSetup() {
+
+  // getSketchSize() verifies the whole app image in flash - only read it once
+  metrics.sketchSize = ESP.getSketchSize();
+  metrics.sketchSpace = ESP.getFreeSketchSpace();
+  metrics.flashUsage = metrics.sketchSpace ? metrics.sketchSize * 100.0f / metrics.sketchSpace : 0;
+  metrics.heapSize = ESP.getHeapSize();
+  metrics.restartReason = EspSysUtil::RestartReason::get();
+
+  metricsSample();
+}
+
+/**
+ * *******************************************************************
+ * @brief   metrics cyclic function - sample dynamic values
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+void metricsCyclic() { metricsSample(); }
+
+/**
+ * *******************************************************************
+ * @brief   compare direct queries with the use of the snapshot
+ * @param   directUs time of the direct queries of one refresh cycle
+ * @param   cachedUs time to read the same values from the snapshot
+ * @return  none
+ * *******************************************************************/
+void metricsBenchmark(uint32_t *directUs, uint32_t *cachedUs) {
+
+  volatile float sink; // keep the compiler from removing the reads
+  char uptime[64];
+
+  // one refresh cycle before: web, MQTT and telnet query everything on their own
+  uint32_t start = micros();
+  sink = ESP.getSketchSize() * 100.0f / ESP.getFreeSketchSpace();
+  sink = (ESP.getHeapSize() - ESP.getFreeHeap()) * 100.0f / ESP.getHeapSize();
+  sink = ESP.getMaxAllocHeap();
+  sink = ESP.getMinFreeHeap();
+  getUptime(uptime, sizeof(uptime));
+  refreshNetworkInfo();
+  *directUs = micros() - start;
+
+  // the same values from the snapshot
+  start = micros();
+  sink = metrics.flashUsage;
+  sink = metrics.heapUsage;
+  sink = metrics.maxAllocHeap;
+  sink = metrics.minFreeHeap;
+  memcpy(uptime, metrics.uptime, sizeof(uptime));
+  *cachedUs = micros() - start;
+  (void)sink;
+}
@@ -4,6 +4,7 @@
 #include <message.h>
 #include <mqtt.h>
 #include <mqttDiscovery.h>
+#include <mqttLog.h>
 #include <queue>
 
 #define MAX_MQTT_CMD 20
@@ -16,6 +17,7 @@ struct s_MqttMessage {
   int len;
 };
 
+s_mqttstat mqttStat;
 std::queue<s_MqttMessage> mqttCmdQueue;
 static void processMqttMessage();
 static AsyncMqttClient mqtt_client;
@@ -45,6 +47,7 @@ void addMqttCmd(const char *topic, const char *payload, int len) {
     mqttCmdQueue.push(message);
     ESP_LOGD(TAG, "add msg to buffer: %s, %s", topic, payload);
   } else {
+    mqttStat.cmdDropped++;
     ESP_LOGE(TAG, "too many commands within too short time");
   }
 }
@@ -55,7 +58,29 @@ void addMqttCmd(const char *topic, const char *payload, int len) {
  * @param   topic, payload, retained
  * @return  none
  * *******************************************************************/
-void mqttPublish(const char *topic, const char *payload, boolean retained) { mqtt_client.publish(topic, 0, retained, payload); }
+void mqttPublish(const char *topic, const char *payload, boolean retained) {
+  if (mqtt_client.publish(topic, 0, retained, payload) == 0) {
+    mqttStat.publishFailed++;
+  } else {
+    mqttStat.published++;
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   mqtt publish wrapper for payload with given length
+ * @param   topic, payload, len, qos
+ * @return  packet id (0 if publish was not possible)
+ * *******************************************************************/
+uint16_t mqttPublishBuffer(const char *topic, const char *payload, size_t len, uint8_t qos) {
+  uint16_t packetId = mqtt_client.publish(topic, qos, false, payload, len);
+  if (packetId == 0) {
+    mqttStat.publishFailed++;
+  } else {
+    mqttStat.published++;
+  }
+  return packetId;
+}
 
 /**
  * *******************************************************************
@@ -91,6 +116,7 @@ void onMqttMessage(char *topic, char *payload, AsyncMqttClientMessageProperties
 
   s_MqttMessage msgCpy;
 
+  mqttStat.received++;
   msgCpy.len = len;
 
   if (topic == NULL) {
@@ -119,6 +145,7 @@ void onMqttMessage(char *topic, char *payload, AsyncMqttClientMessageProperties
  * *******************************************************************/
 void onMqttConnect(bool sessionPresent) {
   mqtt_retry = 0;
+  mqttStat.connects++;
   ESP_LOGI(TAG, "MQTT connected");
   // Once connected, publish an announcement...
   sendWiFiInfo();
@@ -136,6 +163,7 @@ void onMqttConnect(bool sessionPresent) {
  * *******************************************************************/
 void onMqttDisconnect(AsyncMqttClientDisconnectReason reason) {
 
+  mqttStat.disconnects++;
   switch (reason) {
   case AsyncMqttClientDisconnectReason::TCP_DISCONNECTED:
     snprintf(lastError, sizeof(lastError), "TCP DISCONNECTED");
@@ -185,6 +213,7 @@ void mqttSetup() {
   mqtt_client.onConnect(onMqttConnect);
   mqtt_client.onDisconnect(onMqttDisconnect);
   mqtt_client.onMessage(onMqttMessage);
+  mqtt_client.onPublish(mqttLogOnPublish);
   mqtt_client.setServer(config.mqtt.server, config.mqtt.port);
   mqtt_client.setClientId(config.wifi.hostname);
   mqtt_client.setCredentials(config.mqtt.user, config.mqtt.password);
@@ -237,6 +266,9 @@ void mqttCyclic() {
     }
   }
 
+  // forward log entries
+  mqttLogCyclic();
+
   // send bootup messages after restart and established mqtt connection
   if (!bootUpMsgDone && mqtt_client.connected()) {
     bootUpMsgDone = true;
@@ -270,11 +302,14 @@ void processMqttMessage() {
 
     // reconfigure
   } else if (strcasecmp(msgCpy.topic, addTopic("/cmd/reconfigure")) == 0) {
-    mqttDiscoverySetup(true);
-    yield();
-    delay(1000);
-    yield();
-    mqttDiscoverySetup(false);
+    mqttDiscoverySetup(true); // delete and resend discovery configuration
+
+    // log level per tag: <topic>/setvalue/loglevel/<TAG>
+  } else if (strncasecmp(msgCpy.topic, addCfgCmdTopic("loglevel/"), strlen(addCfgCmdTopic("loglevel/"))) == 0) {
+    const char *tag = msgCpy.topic + strlen(addCfgCmdTopic("loglevel/"));
+    if (!setTagLogLevel(tag, logLevelFromString(msgCpy.payload))) {
+      mqttPublish(addTopic("/message"), "invalid log tag or level", false);
+    }
 
     // homeassistant/status
   } else if (strcmp(msgCpy.topic, "homeassistant/status") == 0) {
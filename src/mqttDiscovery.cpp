@@ -1,8 +1,10 @@
 #include <basics.h>
+#include <jsonArena.h>
 #include <language.h>
 #include <message.h>
 #include <mqtt.h>
 #include <mqttDiscovery.h>
+#include <scheduler.h>
 
 /* D E C L A R A T I O N S ****************************************************/
 char discoveryPrefix[128];
@@ -12,6 +14,14 @@ char deviceId[32];
 char swVersion[32];
 
 static bool resetMqttConfig = false;
+static bool resetPending = false;        // request to delete the discovery configuration
+static bool sendPending = false;         // request to send the discovery configuration
+static bool runActive = false;           // a sliced discovery run is in progress
+static int haMsgIdx = 0;                 // index of the actual message within the run
+static int haMsgSent = 0;                // number of messages already sent in this run
+static int haSliceStart = 0;             // number of messages sent before the actual slice
+static unsigned long sendNotBefore = 0;  // delay between reset and resend
+static JsonArena discoveryArena("discovery", 2048); // JSON memory for discovery messages
 
 enum DeviceType { DEV_TEXT, DEV_BTN };
 enum statType { TYP_STATUS, TYP_INFO, TYP_WIFI, TYP_ETH, TYP_SYSINFO, TYP_CMD_BTN, TYP_SHUTTER, TYP_GROUP };
@@ -65,7 +75,15 @@ void mqttHaConfig(statType statType, const char *name, const char *deviceClass,
     return;
   }
 
-  JsonDocument doc;
+  // sliced execution: skip messages of previous slices and stop if the time budget is exhausted
+  // (at least one message per slice is sent)
+  int idx = haMsgIdx++;
+  if (idx != haMsgSent || (idx > haSliceStart && schedTimeLeft() == 0)) {
+    return;
+  }
+  haMsgSent++;
+
+  JsonDocument doc(&discoveryArena);
   char cmdTopic[256];
   char configTopic[256];
 
@@ -161,13 +179,11 @@ void mqttHaConfig(statType statType, const char *name, const char *deviceClass,
 
 /**
  * *******************************************************************
- * @brief   mqttDiscovery Setup function
+ * @brief   generate all discovery messages (one slice of a run)
  * @param   none
  * @return  none
  * *******************************************************************/
-void mqttDiscoverySetup(bool reset) {
-
-  resetMqttConfig = reset;
+static void mqttDiscoveryMessages() {
 
   // copy config values
   snprintf(discoveryPrefix, sizeof(discoveryPrefix), "%s", config.mqtt.ha_topic);
@@ -198,3 +214,64 @@ void mqttDiscoverySetup(bool reset) {
   mqttHaConfig(TYP_SYSINFO, "flash", NULL, "sensor", "%", "{{ value_json.flash.split(' ')[0] }}", "mdi:harddisk", DEV_TEXT, nullPar());
   mqttHaConfig(TYP_SYSINFO, "sw_version", NULL, "sensor", NULL, "{{ value_json.sw_version }}", "mdi:github", DEV_TEXT, nullPar());
 }
+
+/**
+ * *******************************************************************
+ * @brief   mqttDiscovery Setup function - request discovery run
+ * @param   reset true = delete discovery configuration and resend it, false = send it
+ * @return  none
+ * *******************************************************************/
+void mqttDiscoverySetup(bool reset) {
+
+  if (reset) {
+    resetPending = true;
+    sendPending = true; // resend after reset
+  } else {
+    sendPending = true;
+  }
+  schedTrigger("discovery");
+}
+
+/**
+ * *******************************************************************
+ * @brief   mqttDiscovery cyclic function - send messages in slices
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+void mqttDiscoveryCyclic() {
+
+  if (!runActive) {
+    if (resetPending) {
+      resetMqttConfig = true;
+      resetPending = false;
+    } else if (sendPending && (long)(millis() - sendNotBefore) >= 0) {
+      resetMqttConfig = false;
+      sendPending = false;
+    } else {
+      if (sendPending) {
+        schedContinue(); // wait for the delay after reset
+      }
+      return;
+    }
+    runActive = true;
+    haMsgSent = 0;
+  }
+
+  haMsgIdx = 0;
+  haSliceStart = haMsgSent;
+  mqttDiscoveryMessages();
+
+  if (haMsgSent < haMsgIdx) {
+    schedContinue(); // more messages pending
+    return;
+  }
+
+  // run finished
+  runActive = false;
+  if (resetMqttConfig) {
+    sendNotBefore = millis() + 1000;
+  }
+  if (resetPending || sendPending) {
+    schedContinue();
+  }
+}
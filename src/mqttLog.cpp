@@ -0,0 +1,191 @@
+#include <basics.h>
+#include <jsonArena.h>
+#include <message.h>
+#include <mqtt.h>
+#include <mqttLog.h>
+
+/* S E T T I N G S ****************************************************/
+#define MQTT_LOG_BATCH_SIZE 1024   // max payload size of one batch
+#define MQTT_LOG_BATCH_TIME 5000   // max time in ms to collect entries for one batch
+#define MQTT_LOG_MAX_INFLIGHT 2    // max number of unacknowledged batches (congestion)
+#define MQTT_LOG_ENTRY_SIZE 256    // max size of one serialized entry
+
+/* D E C L A R A T I O N S ****************************************************/
+s_mqttlog mqttLog;
+
+static const char *TAG = "MQTT"; // LOG TAG
+static const char *LEVEL_NAME[] = {"N", "E", "W", "I", "D", "V"};
+static uint32_t logCursor = 0;                                  // sequence number of the next log entry to forward
+static char batchBuf[MQTT_LOG_BATCH_SIZE];                      // payload of the pending batch
+static size_t batchLen = 0;                                     // length of the pending batch
+static uint32_t batchCount = 0;                                 // number of entries in the pending batch
+static uint32_t batchStartMs = 0;                               // time of the first entry in the pending batch
+static uint16_t inflight[MQTT_LOG_MAX_INFLIGHT];                // packet ids of unacknowledged batches (0 = free)
+static bool cursorInit = false;
+static JsonArena entryArena("mqttlog", 512);                    // JSON memory for one log entry
+static portMUX_TYPE inflightMux = portMUX_INITIALIZER_UNLOCKED; // PUBACK is received in the AsyncTCP task
+
+/**
+ * *******************************************************************
+ * @brief   callback for acknowledged mqtt publish
+ * @details only acknowledgements of log batches release an inflight slot
+ * @param   packetId
+ * @return  none
+ * *******************************************************************/
+void mqttLogOnPublish(uint16_t packetId) {
+  portENTER_CRITICAL(&inflightMux);
+  for (int i = 0; i < MQTT_LOG_MAX_INFLIGHT; i++) {
+    if (inflight[i] == packetId) {
+      inflight[i] = 0;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&inflightMux);
+}
+
+/**
+ * *******************************************************************
+ * @brief   get free inflight slot
+ * @param   none
+ * @return  index of the slot (-1 if all batches are unacknowledged)
+ * *******************************************************************/
+static int inflightSlot() {
+  int slot = -1;
+  portENTER_CRITICAL(&inflightMux);
+  for (int i = 0; i < MQTT_LOG_MAX_INFLIGHT; i++) {
+    if (inflight[i] == 0) {
+      slot = i;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&inflightMux);
+  return slot;
+}
+
+/**
+ * *******************************************************************
+ * @brief   serialize one log entry (JSON line or MessagePack)
+ * @param   seq sequence number of the log entry
+ * @param   buf output buffer
+ * @param   size size of output buffer
+ * @return  length of serialized entry (0 if entry is not available)
+ * *******************************************************************/
+static size_t serializeLogEntry(uint32_t seq, char *buf, size_t size) {
+  const s_logmeta *meta = logEntryMeta(seq);
+  if (meta == NULL) {
+    return 0;
+  }
+
+  JsonDocument doc(&entryArena);
+  doc["time"] = (uint32_t)meta->time;
+  doc["level"] = LEVEL_NAME[meta->level];
+  doc["tag"] = logTagName(meta->tag);
+  doc["msg"] = logEntryText(seq) + meta->text;
+
+#ifdef MQTT_LOG_MSGPACK
+  return serializeMsgPack(doc, buf, size);
+#else
+  size_t len = serializeJson(doc, buf, size);
+  if (len + 1 >= size) {
+    return 0;
+  }
+  buf[len++] = '\n';
+  return len;
+#endif
+}
+
+/**
+ * *******************************************************************
+ * @brief   publish pending batch
+ * @param   none
+ * @return  true if the batch was published
+ * *******************************************************************/
+static bool publishBatch() {
+  int slot = inflightSlot();
+  if (slot < 0) {
+    return false; // broker connection is congested - try again later
+  }
+
+  uint16_t packetId = mqttPublishBuffer(addTopic("/log"), batchBuf, batchLen, 1);
+  if (packetId == 0) {
+    // publish not possible (e.g. low memory) - drop the batch
+    mqttLog.dropped += batchCount;
+  } else {
+    portENTER_CRITICAL(&inflightMux);
+    inflight[slot] = packetId;
+    portEXIT_CRITICAL(&inflightMux);
+    mqttLog.forwarded += batchCount;
+    mqttLog.batches++;
+  }
+  batchLen = 0;
+  batchCount = 0;
+  return true;
+}
+
+/**
+ * *******************************************************************
+ * @brief   cyclic function to forward log entries via mqtt
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+void mqttLogCyclic() {
+
+  if (!config.log.mqtt_enable) {
+    cursorInit = false;
+    return;
+  }
+
+  // start with the oldest entry in the log buffer (includes the boot messages)
+  if (!cursorInit) {
+    logCursor = logData.tail;
+    cursorInit = true;
+  }
+
+  if (!mqttIsConnected()) {
+    // unacknowledged batches are lost with the connection
+    portENTER_CRITICAL(&inflightMux);
+    memset(inflight, 0, sizeof(inflight));
+    portEXIT_CRITICAL(&inflightMux);
+    return;
+  }
+
+  // entries that have been overwritten or cleared before they could be forwarded
+  if (logCursor < logData.tail) {
+    mqttLog.dropped += logData.tail - logCursor;
+    logCursor = logData.tail;
+  }
+
+  char entry[MQTT_LOG_ENTRY_SIZE];
+  while (logCursor < logData.head) {
+    const s_logmeta *meta = logEntryMeta(logCursor);
+    if (meta == NULL || meta->level > config.log.mqtt_level) {
+      logCursor++;
+      continue;
+    }
+
+    size_t len = serializeLogEntry(logCursor, entry, sizeof(entry));
+    if (len == 0) {
+      mqttLog.dropped++;
+      logCursor++;
+      continue;
+    }
+
+    // batch is full - publish it first
+    if (batchLen + len > sizeof(batchBuf) && !publishBatch()) {
+      return;
+    }
+
+    if (batchCount == 0) {
+      batchStartMs = millis();
+    }
+    memcpy(&batchBuf[batchLen], entry, len);
+    batchLen += len;
+    batchCount++;
+    logCursor++;
+  }
+
+  // publish batch if it is almost full or old enough
+  if (batchCount > 0 && (batchLen >= sizeof(batchBuf) * 3 / 4 || millis() - batchStartMs >= MQTT_LOG_BATCH_TIME)) {
+    publishBatch();
+  }
+}
@@ -0,0 +1,432 @@
+#include <basics.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include <esp_timer.h>
+#include <mbedtls/sha256.h>
+#include <otaDelta.h>
+#include <otaInflate.h>
+#include <otaWriter.h>
+
+/* D E C L A R A T I O N S ****************************************************/
+static const char *TAG = "OTA"; // LOG TAG
+s_otadeltastat otaDeltaStat;
+
+// patch operations (see scripts/delta_ota.py)
+enum e_deltaop {
+  DELTA_OP_END = 0,    // end of patch
+  DELTA_OP_COPY = 1,   // copy n bytes from the old image
+  DELTA_OP_ADD = 2,    // n bytes of the old image plus n data bytes
+  DELTA_OP_INSERT = 3, // n data bytes
+  DELTA_OP_SEEK = 4,   // move position in the old image (zigzag)
+};
+
+enum e_deltastate {
+  STREAM_DETECT, // first bytes decide between image and patch
+  STREAM_IMAGE,  // plain image - passed through to the OTA writer
+  STREAM_HEADER, // patch header
+  STREAM_OP,     // next operation
+  STREAM_ARG,    // argument of the operation (varint)
+  STREAM_DATA,   // data bytes of ADD and INSERT
+  STREAM_END,    // END operation received
+  STREAM_FAILED, // error - ignore the rest of the stream
+};
+
+static bool streamActive = false;
+static e_deltastate state;
+static s_otazheader zhdr;                   // header of a compressed stream
+static size_t zhdrLen;                      // received bytes of the compressed header
+static uint32_t inflated;                   // decompressed bytes
+static size_t streamSize;                   // size of the stream (0 = unknown)
+static s_otadeltaheader hdr;                // patch header
+static size_t hdrLen;                       // received bytes of the header
+static uint8_t op;                          // current operation
+static uint32_t arg;                        // argument of the current operation
+static uint8_t argShift;                    // varint decoder
+static uint32_t remaining;                  // remaining data bytes of the current operation
+static uint32_t oldPos;                     // read position in the old image
+static uint32_t newPos;                     // write position in the new image
+static const esp_partition_t *oldPartition; // running firmware
+static uint8_t cache[OTA_DELTA_CACHE];      // read cache of the old image
+static uint32_t cacheOfs, cacheLen;         // cached part of the old image
+static uint8_t outBuf[OTA_DELTA_OUT];       // output of the patch operations
+static size_t outLen;                       // number of bytes in the output buffer
+
+/**
+ * *******************************************************************
+ * @brief   stop the update with an error
+ * @param   error error message (NULL = keep the error of the OTA writer)
+ * @return  false
+ * *******************************************************************/
+static bool streamFail(const char *error) {
+  const char *msg = error ? error : otaStat.error;
+  if (otaStat.active) {
+    otaWriterAbort();
+  }
+  otaStat.error = msg;
+  state = STREAM_FAILED;
+  ESP_LOGE(TAG, "update failed: %s", msg ? msg : "unknown");
+  return false;
+}
+
+/**
+ * *******************************************************************
+ * @brief   read from the old image at the current position
+ * @param   dst, len destination and number of bytes
+ * @return  false if the read is outside of the old image
+ * *******************************************************************/
+static bool oldRead(uint8_t *dst, size_t len) {
+  if ((uint64_t)oldPos + len > hdr.oldSize) {
+    return false;
+  }
+  while (len > 0) {
+    if (oldPos < cacheOfs || oldPos >= cacheOfs + cacheLen) {
+      cacheOfs = oldPos;
+      cacheLen = min((uint32_t)OTA_DELTA_CACHE, hdr.oldSize - oldPos);
+      if (esp_partition_read(oldPartition, cacheOfs, cache, cacheLen) != ESP_OK) {
+        cacheLen = 0;
+        return false;
+      }
+    }
+    size_t n = min(len, (size_t)(cacheOfs + cacheLen - oldPos));
+    memcpy(dst, cache + (oldPos - cacheOfs), n);
+    dst += n;
+    len -= n;
+    oldPos += n;
+  }
+  return true;
+}
+
+/**
+ * *******************************************************************
+ * @brief   pass the output buffer to the OTA writer
+ * @param   none
+ * @return  false if the flash write has failed
+ * *******************************************************************/
+static bool outFlush() {
+  bool ok = (outLen == 0) || otaWriterWrite(outBuf, outLen);
+  outLen = 0;
+  return ok;
+}
+
+/**
+ * *******************************************************************
+ * @brief   check that the patch fits the running firmware and start the
+ *          OTA writer with the size of the new image
+ * @param   none
+ * @return  false if the patch can not be applied
+ * *******************************************************************/
+static bool deltaStart() {
+  int64_t start = esp_timer_get_time();
+
+  oldPartition = esp_ota_get_running_partition();
+  if (oldPartition == NULL || hdr.oldSize > oldPartition->size) {
+    return streamFail("patch does not match the installed firmware");
+  }
+  mbedtls_sha256_context ctx;
+  uint8_t sha[32];
+  bool readOk = true;
+  mbedtls_sha256_init(&ctx);
+  mbedtls_sha256_starts(&ctx, 0);
+  for (uint32_t ofs = 0; ofs < hdr.oldSize && readOk; ofs += OTA_DELTA_CACHE) {
+    uint32_t n = min((uint32_t)OTA_DELTA_CACHE, hdr.oldSize - ofs);
+    readOk = esp_partition_read(oldPartition, ofs, cache, n) == ESP_OK;
+    mbedtls_sha256_update(&ctx, cache, n);
+  }
+  mbedtls_sha256_finish(&ctx, sha);
+  mbedtls_sha256_free(&ctx);
+  otaDeltaStat.verifyMs = (esp_timer_get_time() - start) / 1000;
+  if (!readOk || memcmp(sha, hdr.oldSha256, sizeof(sha)) != 0) {
+    return streamFail("patch does not match the installed firmware");
+  }
+
+  if (!otaWriterBegin(hdr.newSize)) {
+    state = STREAM_FAILED;
+    return false;
+  }
+  oldPos = newPos = 0;
+  cacheOfs = cacheLen = 0;
+  outLen = 0;
+  state = STREAM_OP;
+  ESP_LOGI(TAG, "delta patch: %" PRIu32 " -> %" PRIu32 " bytes (verify: %" PRIu32 " ms)", hdr.oldSize, hdr.newSize, otaDeltaStat.verifyMs);
+  return true;
+}
+
+/**
+ * *******************************************************************
+ * @brief   execute the current operation after its argument is complete
+ * @param   none
+ * @return  false if the patch is corrupt or the flash write has failed
+ * *******************************************************************/
+static bool deltaExecute() {
+  if (op == DELTA_OP_SEEK) {
+    int64_t pos = (int64_t)oldPos + (int32_t)((arg >> 1) ^ -(arg & 1));
+    if (pos < 0 || pos > hdr.oldSize) {
+      return streamFail("patch corrupt");
+    }
+    oldPos = pos;
+    state = STREAM_OP;
+    return true;
+  }
+  if ((uint64_t)newPos + arg > hdr.newSize) {
+    return streamFail("patch corrupt");
+  }
+  newPos += arg;
+  if (op != DELTA_OP_COPY) {
+    remaining = arg;
+    state = remaining > 0 ? STREAM_DATA : STREAM_OP;
+    return true;
+  }
+  // COPY has no data in the patch
+  while (arg > 0) {
+    size_t n = min((size_t)arg, (size_t)(OTA_DELTA_OUT - outLen));
+    if (!oldRead(outBuf + outLen, n)) {
+      return streamFail("patch corrupt");
+    }
+    outLen += n;
+    arg -= n;
+    if (outLen == OTA_DELTA_OUT && !outFlush()) {
+      return streamFail(NULL);
+    }
+  }
+  state = STREAM_OP;
+  return true;
+}
+
+/**
+ * *******************************************************************
+ * @brief   start OTA update with a firmware image or a delta patch
+ * @details the first bytes decide: a compressed stream (OTA_Z_MAGIC) is
+ *          decompressed first, a delta patch (OTA_DELTA_MAGIC) is
+ *          applied to the running firmware, anything else is written
+ *          as it is
+ * @param   size size of the stream (0 = unknown)
+ * @return  true if the stream has been started
+ * *******************************************************************/
+bool otaStreamBegin(size_t size) {
+  if (streamActive || otaStat.active) {
+    ESP_LOGE(TAG, "update already in progress");
+    return false;
+  }
+  memset(&otaDeltaStat, 0, sizeof(otaDeltaStat));
+  otaStat.error = NULL;
+  streamActive = true;
+  streamSize = size;
+  zhdrLen = 0;
+  inflated = 0;
+  hdrLen = 0;
+  state = STREAM_DETECT;
+  return true;
+}
+
+/**
+ * *******************************************************************
+ * @brief   add data of the (decompressed) image or patch
+ * @details the patch is applied on the fly - only the header, a read
+ *          cache and an output buffer are held in RAM
+ * @param   data, len image or patch data
+ * @return  false if the update has failed
+ * *******************************************************************/
+static bool streamPayload(const uint8_t *data, size_t len) {
+  if (otaDeltaStat.compressed) {
+    inflated += len;
+  }
+  while (len > 0) {
+    switch (state) {
+    case STREAM_DETECT:
+    case STREAM_HEADER: {
+      size_t want = (state == STREAM_DETECT) ? sizeof(hdr.magic) : sizeof(hdr);
+      size_t n = min(len, want - hdrLen);
+      memcpy((uint8_t *)&hdr + hdrLen, data, n);
+      hdrLen += n;
+      data += n;
+      len -= n;
+      if (hdrLen < want) {
+        break;
+      }
+      if (state == STREAM_HEADER) {
+        if (!deltaStart()) {
+          return false;
+        }
+      } else if (hdr.magic == OTA_DELTA_MAGIC) {
+        otaDeltaStat.delta = true;
+        state = STREAM_HEADER;
+      } else {
+        if (!otaWriterBegin(streamSize) || !otaWriterWrite((const uint8_t *)&hdr, hdrLen)) {
+          return streamFail(NULL);
+        }
+        state = STREAM_IMAGE;
+      }
+      break;
+    }
+    case STREAM_IMAGE:
+      if (!otaWriterWrite(data, len)) {
+        return streamFail(NULL);
+      }
+      len = 0;
+      break;
+    case STREAM_OP:
+      op = *data++;
+      len--;
+      if (op == DELTA_OP_END) {
+        state = STREAM_END;
+      } else if (op > DELTA_OP_SEEK) {
+        return streamFail("patch corrupt");
+      } else {
+        arg = 0;
+        argShift = 0;
+        state = STREAM_ARG;
+      }
+      break;
+    case STREAM_ARG: {
+      uint8_t b = *data++;
+      len--;
+      arg |= (uint32_t)(b & 0x7F) << argShift;
+      argShift += 7;
+      if (!(b & 0x80)) {
+        if (!deltaExecute()) {
+          return false;
+        }
+      } else if (argShift >= 32) {
+        return streamFail("patch corrupt");
+      }
+      break;
+    }
+    case STREAM_DATA: {
+      size_t n = min(min(len, (size_t)remaining), (size_t)(OTA_DELTA_OUT - outLen));
+      if (op == DELTA_OP_ADD) {
+        if (!oldRead(outBuf + outLen, n)) {
+          return streamFail("patch corrupt");
+        }
+        for (size_t i = 0; i < n; i++) {
+          outBuf[outLen + i] += data[i];
+        }
+      } else {
+        memcpy(outBuf + outLen, data, n);
+      }
+      outLen += n;
+      data += n;
+      len -= n;
+      remaining -= n;
+      if (outLen == OTA_DELTA_OUT && !outFlush()) {
+        return streamFail(NULL);
+      }
+      if (remaining == 0) {
+        state = STREAM_OP;
+      }
+      break;
+    }
+    case STREAM_END:
+      return streamFail("patch corrupt");
+    case STREAM_FAILED:
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * *******************************************************************
+ * @brief   add received data
+ * @param   data, len received data
+ * @return  false if the update has failed
+ * *******************************************************************/
+bool otaStreamWrite(const uint8_t *data, size_t len) {
+  if (!streamActive) {
+    return false;
+  }
+  otaDeltaStat.received += len;
+
+  // the magic of a compressed stream is only checked at the start
+  while (len > 0 && zhdrLen < sizeof(zhdr) && state == STREAM_DETECT && !otaDeltaStat.compressed) {
+    size_t want = (zhdrLen < sizeof(zhdr.magic)) ? sizeof(zhdr.magic) : sizeof(zhdr);
+    size_t n = min(len, want - zhdrLen);
+    memcpy((uint8_t *)&zhdr + zhdrLen, data, n);
+    zhdrLen += n;
+    data += n;
+    len -= n;
+    if (zhdrLen == sizeof(zhdr)) {
+      if (!otaInflateBegin()) {
+        return streamFail("out of memory");
+      }
+      otaDeltaStat.compressed = true;
+      streamSize = zhdr.size;
+    } else if (zhdrLen == sizeof(zhdr.magic) && zhdr.magic != OTA_Z_MAGIC) {
+      zhdrLen = sizeof(zhdr); // not compressed - the magic is the start of the image or patch
+      if (!streamPayload((const uint8_t *)&zhdr, sizeof(zhdr.magic))) {
+        return false;
+      }
+    }
+  }
+  if (len == 0) {
+    return true;
+  }
+  if (otaDeltaStat.compressed) {
+    if (!otaInflateWrite(data, len, streamPayload)) {
+      return (state == STREAM_FAILED) ? false : streamFail("compressed data corrupt");
+    }
+    return true;
+  }
+  return streamPayload(data, len);
+}
+
+/**
+ * *******************************************************************
+ * @brief   finish OTA update: check and activate the new image
+ * @details the image of a delta patch or a compressed image is checked
+ *          against the SHA-256 of its header
+ * @param   none
+ * @return  true if the new image is valid and active after restart
+ * *******************************************************************/
+bool otaStreamEnd() {
+  if (!streamActive) {
+    return false;
+  }
+  streamActive = false;
+
+  if (otaDeltaStat.compressed) {
+    bool complete = otaInflateDone() && inflated == zhdr.size;
+    otaInflateEnd();
+    if (complete) {
+      ESP_LOGI(TAG, "decompressed %" PRIu32 " -> %" PRIu32 " bytes", otaDeltaStat.received, inflated);
+    } else if (state != STREAM_FAILED) {
+      return streamFail("compressed data incomplete");
+    }
+  }
+
+  switch (state) {
+  case STREAM_IMAGE:
+    return otaWriterEnd(otaDeltaStat.compressed ? zhdr.sha256 : NULL);
+  case STREAM_END:
+    if (!outFlush()) {
+      return streamFail(NULL);
+    }
+    if (otaWriterEnd(hdr.newSha256)) {
+      ESP_LOGI(TAG, "delta patch applied (%" PRIu32 " patch bytes for %" PRIu32 " bytes image)", otaDeltaStat.received, hdr.newSize);
+      return true;
+    }
+    return false;
+  case STREAM_DETECT:
+    return streamFail("image too small");
+  case STREAM_FAILED:
+    return false;
+  default:
+    return streamFail("patch incomplete");
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   cancel OTA update (e.g. connection lost) - can be called
+ *          more than once
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+void otaStreamAbort() {
+  if (!streamActive) {
+    return;
+  }
+  streamActive = false;
+  state = STREAM_FAILED;
+  otaWriterAbort();
+  otaInflateEnd();
+}
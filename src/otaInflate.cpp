@@ -0,0 +1,93 @@
+#include <basics.h>
+#include <otaInflate.h>
+#include <rom/miniz.h>
+
+/* D E C L A R A T I O N S ****************************************************/
+static const char *TAG = "OTA"; // LOG TAG
+
+static tinfl_decompressor *inflator = NULL; // state of the ROM decompressor
+static uint8_t *window = NULL;              // output window (TINFL_LZ_DICT_SIZE, wraps around)
+static size_t windowOfs;                    // write position in the window
+static bool finished;                       // end of the deflate stream reached
+
+/**
+ * *******************************************************************
+ * @brief   start decompression of a raw deflate stream
+ * @details uses the tinfl decompressor of the ROM - the only RAM is the
+ *          decompressor state and the fixed 32 KB window
+ * @param   none
+ * @return  false if out of memory
+ * *******************************************************************/
+bool otaInflateBegin() {
+  otaInflateEnd();
+  inflator = (tinfl_decompressor *)malloc(sizeof(tinfl_decompressor));
+  window = (uint8_t *)malloc(TINFL_LZ_DICT_SIZE);
+  if (inflator == NULL || window == NULL) {
+    ESP_LOGE(TAG, "inflate: out of memory");
+    otaInflateEnd();
+    return false;
+  }
+  tinfl_init(inflator);
+  windowOfs = 0;
+  finished = false;
+  return true;
+}
+
+/**
+ * *******************************************************************
+ * @brief   decompress received data
+ * @details the output is passed on in pieces of up to the free part of
+ *          the window, so the window never has to be copied
+ * @param   data, len compressed data
+ * @param   output receives the decompressed data
+ * @return  false if the data is corrupt or the output has failed
+ * *******************************************************************/
+bool otaInflateWrite(const uint8_t *data, size_t len, otaInflateOutput output) {
+  if (inflator == NULL) {
+    return false;
+  }
+  while (true) {
+    size_t inBytes = len;
+    size_t outBytes = TINFL_LZ_DICT_SIZE - windowOfs;
+    tinfl_status status = tinfl_decompress(inflator, data, &inBytes, window, window + windowOfs, &outBytes, TINFL_FLAG_HAS_MORE_INPUT);
+    data += inBytes;
+    len -= inBytes;
+    if (outBytes > 0 && !output(window + windowOfs, outBytes)) {
+      return false;
+    }
+    windowOfs = (windowOfs + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+
+    if (status < TINFL_STATUS_DONE) {
+      ESP_LOGE(TAG, "inflate: corrupt data (%d)", status);
+      return false;
+    }
+    if (status == TINFL_STATUS_DONE) {
+      finished = true;
+      return len == 0; // no data behind the end of the stream
+    }
+    if (status == TINFL_STATUS_NEEDS_MORE_INPUT && len == 0) {
+      return true;
+    }
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   check that the deflate stream is complete
+ * @param   none
+ * @return  true if the end of the stream has been reached
+ * *******************************************************************/
+bool otaInflateDone() { return finished; }
+
+/**
+ * *******************************************************************
+ * @brief   release decompressor and window (can be called more than once)
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+void otaInflateEnd() {
+  free(inflator);
+  free(window);
+  inflator = NULL;
+  window = NULL;
+}
@@ -0,0 +1,396 @@
+#include <basics.h>
+#include <esp_ota_ops.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <mbedtls/sha256.h>
+#include <otaWriter.h>
+
+/* D E C L A R A T I O N S ****************************************************/
+static const char *TAG = "OTA"; // LOG TAG
+s_otastat otaStat;
+
+// filled buffer for the writer task (len 0 = end of image)
+struct s_otablock {
+  uint8_t idx;  // index of the buffer
+  uint16_t len; // number of bytes in the buffer
+};
+
+static uint8_t *otaBuf[OTA_BUF_COUNT];   // receive buffers
+static QueueHandle_t freeQueue = NULL;   // indices of empty buffers
+static QueueHandle_t fullQueue = NULL;   // filled buffers for the writer task
+static SemaphoreHandle_t doneSem = NULL; // writer task has finished
+static const s_otaflash *otaFlash;       // flash backend of the current update
+static mbedtls_sha256_context shaCtx;    // hash of the image (updated by the writer task)
+static int fillIdx = -1;                 // buffer that is filled by the receiver (-1 = none)
+static size_t fillLen = 0;               // number of bytes in the fill buffer
+static volatile bool writeFailed;        // flash write error in the writer task
+static int64_t startUs;                  // start of the update
+static uint64_t flashUs, hashUs, waitUs; // time statistics of the current update
+
+static esp_ota_handle_t otaHandle;
+static const esp_partition_t *otaPartition = NULL;
+
+/**
+ * *******************************************************************
+ * @brief   flash backend: next OTA app partition
+ * *******************************************************************/
+static bool partitionBegin(size_t size) {
+  otaPartition = esp_ota_get_next_update_partition(NULL);
+  if (otaPartition == NULL) {
+    return false;
+  }
+  // erase sector by sector while writing - no long blocking erase at the start
+  return esp_ota_begin(otaPartition, OTA_WITH_SEQUENTIAL_WRITES, &otaHandle) == ESP_OK;
+}
+static bool partitionWrite(const uint8_t *data, size_t len) { return esp_ota_write(otaHandle, data, len) == ESP_OK; }
+static bool partitionEnd() { return esp_ota_end(otaHandle) == ESP_OK && esp_ota_set_boot_partition(otaPartition) == ESP_OK; }
+static void partitionAbort() { esp_ota_abort(otaHandle); }
+static const s_otaflash partitionFlash = {partitionBegin, partitionWrite, partitionEnd, partitionAbort};
+
+/**
+ * *******************************************************************
+ * @brief   flash backend for the benchmark: nothing is written, only
+ *          the typical erase and program times of a SPI NOR flash
+ * *******************************************************************/
+static size_t simErased, simWritten;
+static bool simBegin(size_t size) {
+  simErased = 0;
+  simWritten = 0;
+  return true;
+}
+static bool simWrite(const uint8_t *data, size_t len) {
+  simWritten += len;
+  while (simErased < simWritten) {
+    vTaskDelay(pdMS_TO_TICKS(OTA_SIM_ERASE_MS));
+    simErased += OTA_BUF_SIZE;
+  }
+  vTaskDelay(pdMS_TO_TICKS((len + 255) / 256 * OTA_SIM_PAGE_US / 1000));
+  return true;
+}
+static bool simEnd() { return true; }
+static void simAbort() {}
+static const s_otaflash simFlash = {simBegin, simWrite, simEnd, simAbort};
+
+/**
+ * *******************************************************************
+ * @brief   writer task: hash and write the filled buffers
+ * @param   param unused
+ * @return  none
+ * *******************************************************************/
+static void otaWriterTask(void *param) {
+  s_otablock block;
+
+  while (xQueueReceive(fullQueue, &block, portMAX_DELAY) == pdTRUE && block.len > 0) {
+    if (!writeFailed) {
+      int64_t t0 = esp_timer_get_time();
+      mbedtls_sha256_update(&shaCtx, otaBuf[block.idx], block.len);
+      int64_t t1 = esp_timer_get_time();
+      writeFailed = !otaFlash->write(otaBuf[block.idx], block.len);
+      hashUs += t1 - t0;
+      flashUs += esp_timer_get_time() - t1;
+    }
+    xQueueSend(freeQueue, &block.idx, portMAX_DELAY);
+  }
+  xSemaphoreGive(doneSem);
+  vTaskDelete(NULL);
+}
+
+/**
+ * *******************************************************************
+ * @brief   release buffers, queues and hash context
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+static void otaRelease() {
+  for (int i = 0; i < OTA_BUF_COUNT; i++) {
+    free(otaBuf[i]);
+    otaBuf[i] = NULL;
+  }
+  if (freeQueue != NULL) {
+    vQueueDelete(freeQueue);
+    freeQueue = NULL;
+  }
+  if (fullQueue != NULL) {
+    vQueueDelete(fullQueue);
+    fullQueue = NULL;
+  }
+  if (doneSem != NULL) {
+    vSemaphoreDelete(doneSem);
+    doneSem = NULL;
+  }
+  mbedtls_sha256_free(&shaCtx);
+  fillIdx = -1;
+  otaStat.active = false;
+}
+
+/**
+ * *******************************************************************
+ * @brief   pass the fill buffer to the writer task
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+static void otaHandOver() {
+  s_otablock block = {(uint8_t)fillIdx, (uint16_t)fillLen};
+  xQueueSend(fullQueue, &block, portMAX_DELAY);
+  fillIdx = -1;
+}
+
+/**
+ * *******************************************************************
+ * @brief   send end marker and wait until the writer task has finished
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+static void otaStopWriter() {
+  s_otablock block = {0, 0};
+  xQueueSend(fullQueue, &block, portMAX_DELAY);
+  xSemaphoreTake(doneSem, portMAX_DELAY);
+}
+
+/**
+ * *******************************************************************
+ * @brief   start OTA update
+ * @details received data is copied into one of OTA_BUF_COUNT buffers.
+ *          A full buffer is hashed and written by the writer task while
+ *          the receiver already fills the next one.
+ * @param   size image size (0 = unknown)
+ * @param   flash flash backend (NULL = next OTA partition)
+ * @param   pipelined false: use only one buffer (receive, then write)
+ * @return  true if the update has been started
+ * *******************************************************************/
+bool otaWriterBegin(size_t size, const s_otaflash *flash, bool pipelined) {
+
+  if (otaStat.active) {
+    ESP_LOGE(TAG, "update already in progress");
+    return false;
+  }
+
+  memset(&otaStat, 0, sizeof(otaStat));
+  otaStat.active = true;
+  otaStat.pipelined = pipelined;
+  otaStat.size = size;
+  otaFlash = flash ? flash : &partitionFlash;
+  writeFailed = false;
+  flashUs = hashUs = waitUs = 0;
+  startUs = esp_timer_get_time();
+
+  mbedtls_sha256_init(&shaCtx);
+  mbedtls_sha256_starts(&shaCtx, 0);
+  freeQueue = xQueueCreate(OTA_BUF_COUNT, sizeof(uint8_t));
+  fullQueue = xQueueCreate(OTA_BUF_COUNT + 1, sizeof(s_otablock));
+  doneSem = xSemaphoreCreateBinary();
+  bool buffersOk = (freeQueue != NULL);
+  for (int i = 0; i < (pipelined ? OTA_BUF_COUNT : 1) && buffersOk; i++) {
+    otaBuf[i] = (uint8_t *)malloc(OTA_BUF_SIZE);
+    uint8_t idx = i;
+    buffersOk = (otaBuf[i] != NULL) && xQueueSend(freeQueue, &idx, 0) == pdTRUE;
+  }
+  if (!buffersOk || fullQueue == NULL || doneSem == NULL) {
+    otaStat.error = "out of memory";
+    ESP_LOGE(TAG, "%s", otaStat.error);
+    otaRelease();
+    return false;
+  }
+  if (!otaFlash->begin(size)) {
+    otaStat.error = "flash begin failed";
+    ESP_LOGE(TAG, "%s", otaStat.error);
+    otaRelease();
+    return false;
+  }
+  if (xTaskCreate(otaWriterTask, "otaWriter", OTA_TASK_STACK, NULL, OTA_TASK_PRIO, NULL) != pdPASS) {
+    otaStat.error = "writer task failed";
+    ESP_LOGE(TAG, "%s", otaStat.error);
+    otaFlash->abort();
+    otaRelease();
+    return false;
+  }
+  ESP_LOGI(TAG, "update started (size: %zu, pipelined: %d)", size, pipelined);
+  return true;
+}
+
+/**
+ * *******************************************************************
+ * @brief   add received data to the image
+ * @details blocks only if all buffers are waiting for the flash
+ * @param   data, len received data
+ * @return  false if the update has failed
+ * *******************************************************************/
+bool otaWriterWrite(const uint8_t *data, size_t len) {
+
+  if (!otaStat.active) {
+    return false;
+  }
+  while (len > 0) {
+    if (writeFailed) {
+      otaStat.error = "flash write failed";
+      return false;
+    }
+    if (fillIdx < 0) {
+      uint8_t idx;
+      int64_t t = esp_timer_get_time();
+      xQueueReceive(freeQueue, &idx, portMAX_DELAY);
+      waitUs += esp_timer_get_time() - t;
+      fillIdx = idx;
+      fillLen = 0;
+    }
+    size_t n = min(len, (size_t)(OTA_BUF_SIZE - fillLen));
+    memcpy(otaBuf[fillIdx] + fillLen, data, n);
+    fillLen += n;
+    data += n;
+    len -= n;
+    otaStat.bytes += n;
+    if (fillLen == OTA_BUF_SIZE) {
+      otaHandOver();
+    }
+  }
+  return true;
+}
+
+/**
+ * *******************************************************************
+ * @brief   finish OTA update: write the rest, check and activate the image
+ * @param   expectedSha256 expected hash of the image (NULL = no check)
+ * @return  true if the new image is valid and active after restart
+ * *******************************************************************/
+bool otaWriterEnd(const uint8_t *expectedSha256) {
+
+  if (!otaStat.active) {
+    return false;
+  }
+  if (fillIdx >= 0 && fillLen > 0) {
+    otaHandOver();
+  }
+  otaStopWriter();
+
+  uint8_t sha[32];
+  mbedtls_sha256_finish(&shaCtx, sha);
+  for (int i = 0; i < 32; i++) {
+    snprintf(otaStat.sha256 + i * 2, 3, "%02x", sha[i]);
+  }
+
+  if (writeFailed) {
+    otaStat.error = "flash write failed";
+  } else if (otaStat.size > 0 && otaStat.bytes != otaStat.size) {
+    otaStat.error = "size mismatch";
+  } else if (expectedSha256 != NULL && memcmp(sha, expectedSha256, sizeof(sha)) != 0) {
+    otaStat.error = "SHA-256 mismatch";
+  } else if (!otaFlash->end()) {
+    otaStat.error = "image invalid";
+  }
+  if (otaStat.error != NULL && otaFlash != NULL) {
+    otaFlash->abort();
+  }
+
+  otaStat.durationMs = (esp_timer_get_time() - startUs) / 1000;
+  otaStat.kbps = otaStat.durationMs ? (uint32_t)((uint64_t)otaStat.bytes * 1000 / 1024 / otaStat.durationMs) : 0;
+  otaStat.flashMs = flashUs / 1000;
+  otaStat.hashMs = hashUs / 1000;
+  otaStat.waitMs = waitUs / 1000;
+  otaRelease();
+
+  if (otaStat.error != NULL) {
+    ESP_LOGE(TAG, "update failed: %s", otaStat.error);
+    return false;
+  }
+  ESP_LOGI(TAG, "%" PRIu32 " bytes in %" PRIu32 " ms (%" PRIu32 " KB/s, flash: %" PRIu32 " ms, hash: %" PRIu32 " ms, wait: %" PRIu32 " ms)",
+           otaStat.bytes, otaStat.durationMs, otaStat.kbps, otaStat.flashMs, otaStat.hashMs, otaStat.waitMs);
+  ESP_LOGI(TAG, "SHA-256: %s", otaStat.sha256);
+  return true;
+}
+
+/**
+ * *******************************************************************
+ * @brief   cancel OTA update (e.g. connection lost)
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+void otaWriterAbort() {
+  if (!otaStat.active) {
+    return;
+  }
+  otaStopWriter();
+  otaFlash->abort();
+  otaStat.error = "aborted";
+  otaStat.durationMs = (esp_timer_get_time() - startUs) / 1000;
+  otaRelease();
+  ESP_LOGW(TAG, "update aborted after %" PRIu32 " bytes", otaStat.bytes);
+}
+
+/**
+ * *******************************************************************
+ * @brief   run one simulated update
+ * @details the sender may only send if the receive window has room,
+ *          so a receiver that waits for the flash also slows down the
+ *          network transfer
+ * @param   size image size
+ * @param   kbps network speed in KB/s
+ * @param   rttMs round trip time of the network
+ * @param   pipelined use the double buffered writer
+ * @return  duration in ms
+ * *******************************************************************/
+static uint32_t otaBenchRun(size_t size, uint32_t kbps, uint32_t rttMs, bool pipelined) {
+  const size_t mss = 1436;                                   // TCP segment size
+  const int window = max(1, (int)(OTA_SIM_TCP_WINDOW / mss)); // segments in the receive window
+  static uint8_t segment[mss];                               // content does not matter
+  int64_t consumed[16] = {0};                                // time when a segment was consumed
+  int64_t segmentUs = (int64_t)mss * 1000000 / ((int64_t)kbps * 1024);
+
+  if (!otaWriterBegin(size, &simFlash, pipelined)) {
+    return 0;
+  }
+  int64_t start = esp_timer_get_time();
+  int64_t arrival = start;
+  size_t sent = 0;
+  for (int k = 0; sent < size; k++) {
+    // segment k can be sent when the sender has seen that segment k-window has been consumed
+    int64_t windowOpen = (k >= window) ? consumed[(k - window) % 16] + rttMs * 1000 : start;
+    arrival = max(arrival, windowOpen) + segmentUs;
+    int64_t waitUs = arrival - esp_timer_get_time();
+    if (waitUs > 1000) {
+      vTaskDelay(pdMS_TO_TICKS(waitUs / 1000));
+    }
+    while (esp_timer_get_time() < arrival) {
+    }
+    size_t n = min(mss, size - sent);
+    if (!otaWriterWrite(segment, n)) {
+      otaWriterAbort();
+      return 0;
+    }
+    sent += n;
+    consumed[k % 16] = esp_timer_get_time();
+  }
+  otaWriterEnd(NULL);
+  return (esp_timer_get_time() - start) / 1000;
+}
+
+/**
+ * *******************************************************************
+ * @brief   compare receive-then-write with the pipelined writer
+ * @details uses a simulated flash (OTA_SIM_ERASE_MS per sector,
+ *          OTA_SIM_PAGE_US per page) - the OTA partition is not touched
+ * @param   size image size
+ * @param   kbps network speed in KB/s
+ * @param   rttMs round trip time of the network
+ * @param   result measured times and throughput
+ * @return  none
+ * *******************************************************************/
+void otaWriterBenchmark(size_t size, uint32_t kbps, uint32_t rttMs, s_otabench *result) {
+
+  memset(result, 0, sizeof(s_otabench));
+  if (otaStat.active || size == 0 || kbps == 0) {
+    return;
+  }
+  s_otastat lastUpdate = otaStat; // the benchmark is not an update
+
+  result->serialMs = otaBenchRun(size, kbps, rttMs, false);
+  result->pipeMs = otaBenchRun(size, kbps, rttMs, true);
+  if (result->serialMs > 0) {
+    result->serialKbps = (uint64_t)size * 1000 / 1024 / result->serialMs;
+  }
+  if (result->pipeMs > 0) {
+    result->pipeKbps = (uint64_t)size * 1000 / 1024 / result->pipeMs;
+  }
+  otaStat = lastUpdate;
+}
@@ -0,0 +1,214 @@
+#include <basics.h>
+#include <esp_timer.h>
+#include <github.h>
+#include <metrics.h>
+#include <mqttLog.h>
+#include <otaWriter.h>
+#include <prometheus.h>
+#include <scheduler.h>
+#include <syslogClient.h>
+#include <telnet.h>
+#include <webUI.h>
+#include <wsBroadcast.h>
+
+/* D E C L A R A T I O N S ****************************************************/
+static const char *TAG = "WEB"; // LOG TAG
+static char promBuffer[PROM_BUFFER_SIZE]; // output of the last scrape
+static bool promBusy = false;             // a response is in progress
+static uint32_t promScrapes = 0;          // number of scrapes
+
+/**
+ * *******************************************************************
+ * @brief   append formatted text to the writer
+ * @param   w writer
+ * @param   format printf format
+ * @return  none
+ * *******************************************************************/
+static void __attribute__((format(printf, 2, 3))) promPrintf(s_promwriter &w, const char *format, ...) {
+  if (w.overflow) {
+    return;
+  }
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(w.buf + w.len, w.size - w.len, format, args);
+  va_end(args);
+  if (n < 0 || (size_t)n >= w.size - w.len) {
+    w.overflow = true;
+    return;
+  }
+  w.len += n;
+}
+
+/**
+ * *******************************************************************
+ * @brief   write HELP and TYPE line of a metric
+ * @param   w writer
+ * @param   name name of the metric
+ * @param   type counter, gauge, histogram or summary
+ * @param   help description
+ * @return  none
+ * *******************************************************************/
+static void promHeader(s_promwriter &w, const char *name, const char *type, const char *help) {
+  promPrintf(w, "# HELP espwebui_%s %s\n# TYPE espwebui_%s %s\n", name, help, name, type);
+}
+
+/**
+ * *******************************************************************
+ * @brief   write metric without labels
+ * @param   w writer
+ * @param   name name of the metric
+ * @param   type counter or gauge
+ * @param   help description
+ * @param   value value
+ * @return  none
+ * *******************************************************************/
+static void promMetric(s_promwriter &w, const char *name, const char *type, const char *help, long long value) {
+  promHeader(w, name, type, help);
+  promPrintf(w, "espwebui_%s %lld\n", name, value);
+}
+
+/**
+ * *******************************************************************
+ * @brief   write loop duration as Prometheus histogram
+ * @param   w writer
+ * @param   hist run time histogram of the scheduler
+ * @return  none
+ * *******************************************************************/
+static void promHistogram(s_promwriter &w, const s_schedhist &hist) {
+  promHeader(w, "loop_duration_us", "histogram", "Duration of one main loop iteration in microseconds");
+  uint32_t sum = 0;
+  for (int i = 0; i < SCHED_HIST_BUCKETS - 1; i++) {
+    sum += hist.bucket[i]; // bucket i: 2^i ... 2^(i+1)-1 us (integer run times, so "le" is the largest value of the bucket)
+    promPrintf(w, "espwebui_loop_duration_us_bucket{le=\"%lu\"} %" PRIu32 "\n", (2UL << i) - 1, sum);
+  }
+  promPrintf(w, "espwebui_loop_duration_us_bucket{le=\"+Inf\"} %" PRIu32 "\n", hist.count);
+  promPrintf(w, "espwebui_loop_duration_us_sum %" PRIu64 "\n", hist.sumUs);
+  promPrintf(w, "espwebui_loop_duration_us_count %" PRIu32 "\n", hist.count);
+}
+
+/**
+ * *******************************************************************
+ * @brief   write all metrics in Prometheus text format
+ * @param   buf output buffer
+ * @param   size size of the buffer
+ * @return  number of written bytes (0 if the buffer is too small)
+ * *******************************************************************/
+size_t prometheusWrite(char *buf, size_t size) {
+  s_promwriter w = {buf, size, 0, false};
+
+  // system
+  promHeader(w, "info", "gauge", "Firmware version");
+  promPrintf(w, "espwebui_info{version=\"%s\"} 1\n", VERSION);
+  promMetric(w, "uptime_seconds", "counter", "Time since boot", esp_timer_get_time() / 1000000);
+  promMetric(w, "heap_size_bytes", "gauge", "Total heap size", metrics.heapSize);
+  promMetric(w, "heap_free_bytes", "gauge", "Free heap", metrics.freeHeap);
+  promMetric(w, "heap_max_alloc_bytes", "gauge", "Largest free heap block", metrics.maxAllocHeap);
+  promMetric(w, "heap_min_free_bytes", "gauge", "Lowest free heap since boot", metrics.minFreeHeap);
+
+  // network
+  promMetric(w, "wifi_connected", "gauge", "WiFi connection state", wifi.connected);
+  promMetric(w, "wifi_rssi_dbm", "gauge", "WiFi signal strength", wifi.rssi);
+  promMetric(w, "eth_connected", "gauge", "Ethernet connection state", eth.connected);
+
+  // mqtt
+  promMetric(w, "mqtt_connected", "gauge", "MQTT connection state", mqttIsConnected());
+  promMetric(w, "mqtt_connects_total", "counter", "Established MQTT connections", mqttStat.connects);
+  promMetric(w, "mqtt_disconnects_total", "counter", "Lost MQTT connections", mqttStat.disconnects);
+  promMetric(w, "mqtt_published_total", "counter", "Published MQTT messages", mqttStat.published);
+  promMetric(w, "mqtt_publish_failed_total", "counter", "MQTT messages that could not be published", mqttStat.publishFailed);
+  promMetric(w, "mqtt_received_total", "counter", "Received MQTT messages", mqttStat.received);
+  promMetric(w, "mqtt_cmd_dropped_total", "counter", "MQTT commands lost because the queue was full", mqttStat.cmdDropped);
+
+  // logger
+  promMetric(w, "log_repeated_total", "counter", "Log messages collapsed by deduplication", logData.repeated);
+  promMetric(w, "log_suppressed_total", "counter", "Log messages suppressed by rate limit", logData.suppressed);
+  promHeader(w, "log_dropped_total", "counter", "Log entries lost before they could be forwarded");
+  promPrintf(w, "espwebui_log_dropped_total{sink=\"mqtt\"} %" PRIu32 "\n", mqttLog.dropped);
+  promPrintf(w, "espwebui_log_dropped_total{sink=\"syslog\"} %" PRIu32 "\n", syslogStat.dropped);
+  promMetric(w, "telnet_dropped_bytes_total", "counter", "Bytes of the telnet log stream dropped", telnetIF.droppedBytes);
+
+  // webUI
+  promMetric(w, "ws_clients", "gauge", "Connected WebSocket clients", webUI.getWebSocket().count());
+  promMetric(w, "ws_frames_total", "counter", "JSON frames broadcast to the WebSocket clients", wsBroadcastStat.frames);
+  promMetric(w, "ws_frame_bytes_total", "counter", "Serialized bytes of the broadcast frames (once per frame)", wsBroadcastStat.bytes);
+  promMetric(w, "ws_slow_clients", "gauge", "WebSocket clients over their queue budget (updates merged)", wsBroadcastStat.slowClients);
+  promMetric(w, "ws_frames_merged_total", "counter", "Frames merged for slow WebSocket clients instead of queued", wsBroadcastStat.merged);
+  promMetric(w, "ws_coalesced_total", "counter", "Pending values of slow WebSocket clients replaced by a newer value", wsBroadcastStat.coalesced);
+  promMetric(w, "ws_broadcast_max_us", "gauge", "Longest serialization and queueing of one broadcast", wsBroadcastStat.maxUs);
+  promMetric(w, "web_events_total", "counter", "Received web element events", webEventStat.received);
+  promMetric(w, "web_events_coalesced_total", "counter", "Web element events merged with a pending event", webEventStat.coalesced);
+  promMetric(w, "web_events_dropped_total", "counter", "Web element events lost because the queue was full", webEventStat.dropped);
+
+  // loop timing
+  promHistogram(w, *schedLoopHist());
+  promHeader(w, "task_duration_us", "summary", "Run time of the scheduler tasks in microseconds");
+  for (int i = 0; i < schedTaskCount(); i++) {
+    const s_schedtask *t = schedGetTask(i);
+    promPrintf(w, "espwebui_task_duration_us{task=\"%s\",quantile=\"0.5\"} %" PRIu32 "\n", t->name, schedPercentile(t->hist, 50));
+    promPrintf(w, "espwebui_task_duration_us{task=\"%s\",quantile=\"0.99\"} %" PRIu32 "\n", t->name, schedPercentile(t->hist, 99));
+    promPrintf(w, "espwebui_task_duration_us_sum{task=\"%s\"} %" PRIu64 "\n", t->name, t->hist.sumUs);
+    promPrintf(w, "espwebui_task_duration_us_count{task=\"%s\"} %" PRIu32 "\n", t->name, t->hist.count);
+  }
+  promHeader(w, "task_deadline_misses_total", "counter", "Missed periods of the scheduler tasks");
+  for (int i = 0; i < schedTaskCount(); i++) {
+    const s_schedtask *t = schedGetTask(i);
+    promPrintf(w, "espwebui_task_deadline_misses_total{task=\"%s\"} %" PRIu32 "\n", t->name, t->misses);
+  }
+  promHeader(w, "task_overruns_total", "counter", "Runs of the scheduler tasks above their time budget");
+  for (int i = 0; i < schedTaskCount(); i++) {
+    const s_schedtask *t = schedGetTask(i);
+    promPrintf(w, "espwebui_task_overruns_total{task=\"%s\"} %" PRIu32 "\n", t->name, t->overruns);
+  }
+
+  // ota
+  promMetric(w, "ota_last_duration_ms", "gauge", "Total time of the last OTA update", otaStat.durationMs);
+  promMetric(w, "ota_last_throughput_kbps", "gauge", "Throughput of the last OTA update in KB/s", otaStat.kbps);
+
+  // github release check
+  promMetric(w, "github_requests_total", "counter", "Requests to the GitHub release API", ghCheckStat.requests);
+  promMetric(w, "github_not_modified_total", "counter", "GitHub release requests answered with 304", ghCheckStat.notModified);
+  promMetric(w, "github_cache_hits_total", "counter", "GitHub release checks answered from the cache", ghCheckStat.cacheHits);
+  promMetric(w, "github_errors_total", "counter", "Failed GitHub release requests", ghCheckStat.errors);
+  promMetric(w, "github_last_request_ms", "gauge", "Duration of the last GitHub release request", ghCheckStat.lastMs);
+
+  promMetric(w, "metrics_scrapes_total", "counter", "Scrapes of this endpoint", promScrapes);
+
+  if (w.overflow) {
+    ESP_LOGE(TAG, "prometheus buffer too small");
+    return 0;
+  }
+  return w.len;
+}
+
+/**
+ * *******************************************************************
+ * @brief   register /metrics endpoint
+ * @param   server web server
+ * @return  none
+ * *******************************************************************/
+void prometheusSetup(AsyncWebServer &server) {
+
+  server.on("/metrics", HTTP_GET, [](AsyncWebServerRequest *request) {
+    if (config.auth.enable && !request->authenticate(config.auth.user, config.auth.password)) {
+      return request->requestAuthentication();
+    }
+    // one fixed buffer - Prometheus scrapes a target one after the other
+    if (promBusy) {
+      request->send(503, "text/plain", "scrape in progress");
+      return;
+    }
+    promScrapes++;
+    size_t len = prometheusWrite(promBuffer, sizeof(promBuffer));
+    if (len == 0) {
+      request->send(500, "text/plain", "buffer too small");
+      return;
+    }
+    promBusy = true;
+    request->onDisconnect([]() { promBusy = false; });
+    request->send(request->beginResponse("text/plain; version=0.0.4", len, [len](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+      size_t n = len - index < maxLen ? len - index : maxLen;
+      memcpy(buffer, promBuffer + index, n);
+      return n;
+    }));
+  });
+}
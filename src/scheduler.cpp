@@ -0,0 +1,272 @@
+#include <Arduino.h>
+#include <scheduler.h>
+
+/* D E C L A R A T I O N S ****************************************************/
+static const char *TAG = "MAIN"; // LOG TAG
+static s_schedtask tasks[SCHED_MAX_TASKS]; // sorted by priority
+static int taskCount = 0;
+static s_schedtask *current = NULL;   // task that is running
+static uint32_t currentStart = 0;     // start of the running task (cpu cycles)
+static uint32_t cyclesPerUs = 0;      // cpu frequency in MHz
+static s_schedhist loopHist;          // run time histogram of one loop iteration
+
+/**
+ * *******************************************************************
+ * @brief   elapsed time since a cycle counter value
+ * @param   start cycle counter value at the start
+ * @return  elapsed time in us (valid up to ~26s at 160MHz)
+ * *******************************************************************/
+static inline uint32_t schedElapsedUs(uint32_t start) { return (ESP.getCycleCount() - start) / cyclesPerUs; }
+
+/**
+ * *******************************************************************
+ * @brief   add measurement to histogram
+ * @param   hist histogram
+ * @param   us run time in us
+ * @return  none
+ * *******************************************************************/
+static void schedHistAdd(s_schedhist &hist, uint32_t us) {
+  if (hist.count == 0 || us < hist.minUs) {
+    hist.minUs = us;
+  }
+  if (us > hist.maxUs) {
+    hist.maxUs = us;
+  }
+  int idx = us < 2 ? 0 : 31 - __builtin_clz(us); // floor(log2(us))
+  hist.bucket[idx < SCHED_HIST_BUCKETS ? idx : SCHED_HIST_BUCKETS - 1]++;
+  hist.count++;
+  hist.sumUs += us;
+}
+
+/**
+ * *******************************************************************
+ * @brief   register task
+ * @param   name name of the task (must be a static string)
+ * @param   fn task function
+ * @param   prio priority (0 = highest, never deferred)
+ * @param   periodMs period in ms, SCHED_EVERY_LOOP or SCHED_EVENT
+ * @param   budgetUs time budget of one run in us
+ * @return  false if there are too many tasks
+ * *******************************************************************/
+bool schedAdd(const char *name, schedFunction fn, uint8_t prio, uint32_t periodMs, uint32_t budgetUs) {
+
+  if (taskCount >= SCHED_MAX_TASKS) {
+    ESP_LOGE(TAG, "too many scheduler tasks: %s", name);
+    return false;
+  }
+
+  // insert sorted by priority (tasks with the same priority keep their order)
+  int pos = taskCount;
+  while (pos > 0 && tasks[pos - 1].prio > prio) {
+    tasks[pos] = tasks[pos - 1];
+    pos--;
+  }
+  s_schedtask &t = tasks[pos];
+  memset(&t, 0, sizeof(t));
+  t.name = name;
+  t.fn = fn;
+  t.prio = prio;
+  t.periodMs = periodMs;
+  t.budgetUs = budgetUs;
+  t.dueMs = millis();
+  taskCount++;
+  if (cyclesPerUs == 0) {
+    cyclesPerUs = ESP.getCpuFreqMHz();
+  }
+  return true;
+}
+
+/**
+ * *******************************************************************
+ * @brief   trigger event-driven task (run in the next iteration)
+ * @param   name name of the task
+ * @return  none
+ * *******************************************************************/
+void schedTrigger(const char *name) {
+  for (int i = 0; i < taskCount; i++) {
+    if (strcmp(tasks[i].name, name) == 0) {
+      if (!tasks[i].triggered) {
+        tasks[i].triggered = true;
+        tasks[i].dueMs = millis();
+      }
+      return;
+    }
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   request another slice of the running task in the next iteration
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+void schedContinue() {
+  if (current != NULL) {
+    current->more = true;
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   remaining time budget of the running task
+ * @param   none
+ * @return  remaining time in us (0 = budget exhausted)
+ * *******************************************************************/
+uint32_t schedTimeLeft() {
+  if (current == NULL) {
+    return UINT32_MAX;
+  }
+  uint32_t elapsed = schedElapsedUs(currentStart);
+  return elapsed < current->budgetUs ? current->budgetUs - elapsed : 0;
+}
+
+/**
+ * *******************************************************************
+ * @brief   check if task has to run
+ * @param   t task
+ * @param   now actual time in ms
+ * @return  true if the task is due
+ * *******************************************************************/
+static bool schedDue(const s_schedtask &t, uint32_t now) {
+  if (t.more || t.triggered || t.periodMs == SCHED_EVERY_LOOP) {
+    return true;
+  }
+  return t.periodMs != SCHED_EVENT && (int32_t)(now - t.dueMs) >= 0;
+}
+
+/**
+ * *******************************************************************
+ * @brief   run all due tasks in order of their priority
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+void schedCyclic() {
+
+  uint32_t loopStart = ESP.getCycleCount();
+
+  for (int i = 0; i < taskCount; i++) {
+    s_schedtask &t = tasks[i];
+    uint32_t now = millis();
+
+    if (!schedDue(t, now)) {
+      continue;
+    }
+    if (t.prio > 0 && schedElapsedUs(loopStart) > SCHED_LOOP_BUDGET_US) {
+      t.deferred++;
+      continue;
+    }
+
+    // lateness of a new periodic or event-driven run (not for following slices)
+    if (!t.more && t.periodMs != SCHED_EVERY_LOOP) {
+      uint32_t late = now - t.dueMs;
+      if (late > t.maxLateMs) {
+        t.maxLateMs = late;
+      }
+      if (t.periodMs != SCHED_EVENT && late >= t.periodMs) {
+        t.misses++;
+      }
+    }
+
+    t.more = false;
+    t.triggered = false;
+    current = &t;
+    currentStart = ESP.getCycleCount();
+    t.fn();
+    uint32_t runUs = schedElapsedUs(currentStart);
+    current = NULL;
+
+    schedHistAdd(t.hist, runUs);
+    if (runUs > t.budgetUs) {
+      t.overruns++;
+    }
+
+    // next periodic run - missed periods are skipped
+    if (t.periodMs != SCHED_EVERY_LOOP && t.periodMs != SCHED_EVENT) {
+      t.dueMs += t.periodMs;
+      if ((int32_t)(now - t.dueMs) >= 0) {
+        t.dueMs = now + t.periodMs;
+      }
+    }
+  }
+
+  schedHistAdd(loopHist, schedElapsedUs(loopStart));
+}
+
+/**
+ * *******************************************************************
+ * @brief   number of registered tasks
+ * @param   none
+ * @return  number of tasks
+ * *******************************************************************/
+int schedTaskCount() { return taskCount; }
+
+/**
+ * *******************************************************************
+ * @brief   get task (for statistics)
+ * @param   idx index of the task
+ * @return  task (NULL if index is invalid)
+ * *******************************************************************/
+const s_schedtask *schedGetTask(int idx) { return (idx >= 0 && idx < taskCount) ? &tasks[idx] : NULL; }
+
+/**
+ * *******************************************************************
+ * @brief   find task by name
+ * @param   name name of the task
+ * @return  task (NULL if not found)
+ * *******************************************************************/
+const s_schedtask *schedFindTask(const char *name) {
+  for (int i = 0; i < taskCount; i++) {
+    if (strcasecmp(tasks[i].name, name) == 0) {
+      return &tasks[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * *******************************************************************
+ * @brief   run time histogram of the whole loop iteration
+ * @param   none
+ * @return  histogram
+ * *******************************************************************/
+const s_schedhist *schedLoopHist() { return &loopHist; }
+
+/**
+ * *******************************************************************
+ * @brief   estimate percentile from histogram
+ * @param   hist histogram
+ * @param   pct percentile (0...100)
+ * @return  upper limit of the bucket that contains the percentile in us (limited to max)
+ * *******************************************************************/
+uint32_t schedPercentile(const s_schedhist &hist, uint8_t pct) {
+  if (hist.count == 0) {
+    return 0;
+  }
+  uint32_t rank = (uint32_t)(((uint64_t)hist.count * pct + 99) / 100); // ceil(count * pct / 100)
+  uint32_t sum = 0;
+  for (int i = 0; i < SCHED_HIST_BUCKETS; i++) {
+    sum += hist.bucket[i];
+    if (sum >= rank && sum > 0) {
+      uint32_t upper = (i == SCHED_HIST_BUCKETS - 1) ? hist.maxUs : (2UL << i) - 1;
+      return constrain(upper, hist.minUs, hist.maxUs);
+    }
+  }
+  return hist.maxUs;
+}
+
+/**
+ * *******************************************************************
+ * @brief   reset run time and deadline statistics of all tasks
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+void schedResetStats() {
+  for (int i = 0; i < taskCount; i++) {
+    memset(&tasks[i].hist, 0, sizeof(s_schedhist));
+    tasks[i].overruns = 0;
+    tasks[i].misses = 0;
+    tasks[i].maxLateMs = 0;
+    tasks[i].deferred = 0;
+  }
+  memset(&loopHist, 0, sizeof(loopHist));
+}
@@ -0,0 +1,255 @@
+#include <arpa/inet.h>
+#include <basics.h>
+#include <config.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <lwip/dns.h>
+#include <lwip/tcpip.h>
+#include <message.h>
+#include <sys/socket.h>
+#include <syslogClient.h>
+
+/* S E T T I N G S ****************************************************/
+#define SYSLOG_QUEUE_LEN 8          // number of datagrams in the send queue
+#define SYSLOG_MSG_SIZE 256         // max size of one datagram
+#define SYSLOG_BATCH 8              // max number of datagrams sent per cycle
+#define SYSLOG_RESOLVE_RETRY 60000  // delay between attempts to resolve the server address
+#define SYSLOG_APP_NAME "EspWebUI"  // APP-NAME of syslog messages
+
+/* D E C L A R A T I O N S ****************************************************/
+s_syslog syslogStat;
+
+static const char *TAG = "SYSLOG"; // LOG TAG
+static char queue[SYSLOG_QUEUE_LEN][SYSLOG_MSG_SIZE]; // send queue of formatted datagrams
+static size_t queueLen[SYSLOG_QUEUE_LEN];
+static int queueTail = 0;
+static int queueCount = 0;
+static uint32_t logCursor = 0; // sequence number of the next log entry
+static bool cursorInit = false;
+static int sock = -1;
+static struct sockaddr_in serverAddr;
+static bool serverValid = false;
+static char serverName[sizeof(config.syslog.server)];
+static uint16_t serverPort = 0;
+
+// asynchronous hostname lookup (the lwIP callback runs in the tcpip task)
+enum { DNS_IDLE, DNS_PENDING, DNS_DONE, DNS_FAILED };
+static portMUX_TYPE dnsMux = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t dnsState = DNS_IDLE;
+static uint32_t dnsAddr = 0;     // resolved address (network byte order)
+static uint32_t dnsRequest = 0;  // id of the current lookup - results of older lookups are ignored
+static uint32_t dnsFailedMs = 0; // time of the last failed lookup
+static bool dnsRetry = false;    // wait SYSLOG_RESOLVE_RETRY before the next lookup
+
+/**
+ * *******************************************************************
+ * @brief   map esp log level to syslog severity
+ * @param   level esp_log_level_t
+ * @return  syslog severity
+ * *******************************************************************/
+static uint8_t syslogSeverity(uint8_t level) {
+  switch (level) {
+  case ESP_LOG_ERROR:
+    return 3; // error
+  case ESP_LOG_WARN:
+    return 4; // warning
+  case ESP_LOG_INFO:
+    return 6; // informational
+  default:
+    return 7; // debug
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   result of the hostname lookup (called in the tcpip task)
+ * @param   name hostname
+ * @param   ipaddr resolved address (NULL if the lookup has failed)
+ * @param   arg id of the lookup
+ * @return  none
+ * *******************************************************************/
+static void syslogDnsFound(const char *name, const ip_addr_t *ipaddr, void *arg) {
+  portENTER_CRITICAL(&dnsMux);
+  if ((uint32_t)(uintptr_t)arg == dnsRequest && dnsState == DNS_PENDING) {
+    if (ipaddr != NULL && IP_IS_V4(ipaddr)) {
+      dnsAddr = ip4_addr_get_u32(ip_2_ip4(ipaddr));
+      dnsState = DNS_DONE;
+    } else {
+      dnsState = DNS_FAILED;
+    }
+  }
+  portEXIT_CRITICAL(&dnsMux);
+}
+
+/**
+ * *******************************************************************
+ * @brief   start hostname lookup (called in the tcpip task)
+ * @param   arg id of the lookup
+ * @return  none
+ * *******************************************************************/
+static void syslogDnsStart(void *arg) {
+  ip_addr_t addr;
+  err_t err = dns_gethostbyname(serverName, &addr, syslogDnsFound, arg);
+  if (err != ERR_INPROGRESS) {
+    // cached address or error - no callback from lwIP
+    syslogDnsFound(serverName, (err == ERR_OK) ? &addr : NULL, arg);
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   resolve server hostname without blocking the loop
+ * @param   none
+ * @return  true if the address is resolved
+ * *******************************************************************/
+static bool syslogResolve() {
+  portENTER_CRITICAL(&dnsMux);
+  uint8_t state = dnsState;
+  uint32_t addr = dnsAddr;
+  if (state == DNS_DONE || state == DNS_FAILED) {
+    dnsState = DNS_IDLE;
+  }
+  portEXIT_CRITICAL(&dnsMux);
+
+  switch (state) {
+  case DNS_DONE:
+    serverAddr.sin_addr.s_addr = addr;
+    return true;
+  case DNS_FAILED:
+    ESP_LOGW(TAG, "unable to resolve syslog server: %s", serverName);
+    dnsRetry = true;
+    dnsFailedMs = millis();
+    return false;
+  case DNS_IDLE:
+    if (!dnsRetry || millis() - dnsFailedMs >= SYSLOG_RESOLVE_RETRY) {
+      portENTER_CRITICAL(&dnsMux);
+      dnsState = DNS_PENDING;
+      uint32_t request = dnsRequest;
+      portEXIT_CRITICAL(&dnsMux);
+      if (tcpip_callback(syslogDnsStart, (void *)(uintptr_t)request) != ERR_OK) {
+        syslogDnsFound(serverName, NULL, (void *)(uintptr_t)request);
+      }
+    }
+    return false;
+  default:
+    return false; // lookup in progress
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   open socket and resolve server address (if config has changed)
+ * @param   none
+ * @return  true if the server is ready
+ * *******************************************************************/
+static bool syslogConnect() {
+
+  if (strcmp(serverName, config.syslog.server) != 0 || serverPort != config.syslog.port) {
+    snprintf(serverName, sizeof(serverName), "%s", config.syslog.server);
+    serverPort = config.syslog.port;
+    serverValid = false;
+    // a new server is resolved immediately - results of a running lookup are ignored
+    portENTER_CRITICAL(&dnsMux);
+    dnsRequest++;
+    dnsState = DNS_IDLE;
+    portEXIT_CRITICAL(&dnsMux);
+    dnsRetry = false;
+  }
+
+  if (sock < 0) {
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+      return false;
+    }
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+  }
+
+  if (!serverValid && strlen(serverName) > 0) {
+    memset(&serverAddr, 0, sizeof(serverAddr));
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_port = htons(serverPort);
+    if (inet_pton(AF_INET, serverName, &serverAddr.sin_addr) == 1) {
+      serverValid = true;
+    } else {
+      serverValid = syslogResolve();
+    }
+  }
+  return serverValid;
+}
+
+/**
+ * *******************************************************************
+ * @brief   format new log entries into the send queue
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+static void syslogFillQueue() {
+
+  // entries that have been overwritten or cleared before they could be sent
+  if (logCursor < logData.tail) {
+    syslogStat.dropped += logData.tail - logCursor;
+    logCursor = logData.tail;
+  }
+
+  while (logCursor < logData.head && queueCount < SYSLOG_QUEUE_LEN) {
+    const s_logmeta *meta = logEntryMeta(logCursor);
+    if (meta != NULL && meta->level <= config.syslog.level) {
+      int idx = (queueTail + queueCount) % SYSLOG_QUEUE_LEN;
+      queueLen[idx] = syslogFormat(queue[idx], SYSLOG_MSG_SIZE, syslogSeverity(meta->level), meta->time, config.wifi.hostname, SYSLOG_APP_NAME,
+                                   logTagName(meta->tag), logEntryText(logCursor) + meta->text);
+      queueCount++;
+    }
+    logCursor++;
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   send queued datagrams (non-blocking)
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+static void syslogSendQueue() {
+  for (int i = 0; i < SYSLOG_BATCH && queueCount > 0; i++) {
+    ssize_t res = sendto(sock, queue[queueTail], queueLen[queueTail], MSG_DONTWAIT, (struct sockaddr *)&serverAddr, sizeof(serverAddr));
+    if (res < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOMEM) {
+        return; // network stack is busy - try again in the next cycle
+      }
+      syslogStat.dropped++;
+    } else {
+      syslogStat.sent++;
+    }
+    queueTail = (queueTail + 1) % SYSLOG_QUEUE_LEN;
+    queueCount--;
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   cyclic function to send log entries to a syslog server
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+void syslogCyclic() {
+
+  if (!config.syslog.enable || setupMode) {
+    cursorInit = false;
+    queueCount = 0;
+    return;
+  }
+
+  // start with the oldest entry in the log buffer (includes the boot messages)
+  if (!cursorInit) {
+    logCursor = logData.tail;
+    cursorInit = true;
+  }
+
+  if (!(wifi.connected || eth.connected) || !syslogConnect()) {
+    // new entries are collected in the log buffer until the server is reachable
+    return;
+  }
+
+  syslogFillQueue();
+  syslogSendQueue();
+}
@@ -0,0 +1,33 @@
+#include <stdio.h>
+#include <syslogFormat.h>
+
+/**
+ * *******************************************************************
+ * @brief   build RFC 5424 syslog message
+ * @details no Arduino dependencies - also used by the host test
+ *          (test/host/syslog_test.cpp)
+ * @param   buf output buffer
+ * @param   size size of output buffer
+ * @param   severity syslog severity (0-7)
+ * @param   time timestamp of the message (invalid times are sent as "-")
+ * @param   host HOSTNAME
+ * @param   app APP-NAME
+ * @param   msgId MSGID (e.g. the log tag)
+ * @param   msg message text
+ * @return  length of the message
+ * *******************************************************************/
+size_t syslogFormat(char *buf, size_t size, uint8_t severity, time_t time, const char *host, const char *app, const char *msgId, const char *msg) {
+  char timestamp[32] = "-";
+  if (time > 1609459200) { // time is only valid after NTP sync
+    struct tm tmUtc;
+    gmtime_r(&time, &tmUtc);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", &tmUtc);
+  }
+
+  int len = snprintf(buf, size, "<%d>1 %s %s %s - %s - %s", SYSLOG_FACILITY * 8 + severity, timestamp, (host && host[0]) ? host : "-",
+                     (app && app[0]) ? app : "-", (msgId && msgId[0]) ? msgId : "-", msg);
+  if (len < 0 || size == 0) {
+    return 0;
+  }
+  return ((size_t)len < size) ? len : size - 1;
+}
@@ -1,12 +1,24 @@
 #include "EscapeCodes.h"
 #include <basics.h>
 #include <config.h>
+#include <jsonArena.h>
 #include <language.h>
 #include <message.h>
+#include <metrics.h>
+#include <mqttLog.h>
+#include <otaDelta.h>
+#include <otaWriter.h>
+#include <scheduler.h>
+#include <syslogClient.h>
 #include <telnet.h>
+#include <webAssets.h>
 #include <webUI.h>
+#include <wsBroadcast.h>
 
 /* D E C L A R A T I O N S ****************************************************/
+#define TELNET_TX_BUF_SIZE 2048 // size of output buffer for log stream
+#define TELNET_TX_BATCH 512     // max bytes that are written to the client per cycle
+
 ESPTelnet telnet;
 s_telnetIF telnetIF;
 static EscapeCodes ansi;
@@ -14,6 +26,11 @@ static char param[MAX_PAR][MAX_CHAR];
 static bool msgAvailable = false;
 static const char *TAG = "TELNET"; // LOG TAG
 
+static char txBuf[TELNET_TX_BUF_SIZE]; // output buffer for log stream
+static size_t txTail = 0;              // read position in output buffer
+static size_t txUsed = 0;              // number of bytes in output buffer
+static portMUX_TYPE txMux = portMUX_INITIALIZER_UNLOCKED;
+
 /* P R O T O T Y P E S ********************************************************/
 void readLogger();
 void dispatchCommand(char param[MAX_PAR][MAX_CHAR]);
@@ -22,8 +39,16 @@ void cmdHelp(char param[MAX_PAR][MAX_CHAR]);
 void cmdCls(char param[MAX_PAR][MAX_CHAR]);
 void cmdConfig(char param[MAX_PAR][MAX_CHAR]);
 void cmdInfo(char param[MAX_PAR][MAX_CHAR]);
+void cmdLog(char param[MAX_PAR][MAX_CHAR]);
+void cmdLogLevel(char param[MAX_PAR][MAX_CHAR]);
 void cmdDisconnect(char param[MAX_PAR][MAX_CHAR]);
 void cmdRestart(char param[MAX_PAR][MAX_CHAR]);
+void cmdSched(char param[MAX_PAR][MAX_CHAR]);
+void cmdPerf(char param[MAX_PAR][MAX_CHAR]);
+void cmdMetrics(char param[MAX_PAR][MAX_CHAR]);
+void cmdOtaBench(char param[MAX_PAR][MAX_CHAR]);
+void cmdStream(char param[MAX_PAR][MAX_CHAR]);
+void cmdWsBench(char param[MAX_PAR][MAX_CHAR]);
 
 Command commands[] = {
     {"cls", cmdCls, "Clear screen", ""},
@@ -31,7 +56,15 @@ Command commands[] = {
     {"disconnect", cmdDisconnect, "disconnect telnet", ""},
     {"help", cmdHelp, "Displays this help message", "[command]"},
     {"info", cmdInfo, "Print system information", ""},
+    {"log", cmdLog, "Print log buffer - filtered by tags, minimum level and last x minutes", "[tag,tag|*] [E|W|I|D|V] [minutes]"},
+    {"loglevel", cmdLogLevel, "Print or set log level per tag (0 = global log level)", "[tag] [0|E|W|I|D]"},
+    {"metrics", cmdMetrics, "Print metrics sampler statistics and benchmark direct queries against the snapshot", ""},
+    {"otabench", cmdOtaBench, "Print last OTA update and compare receive-then-write with the pipelined writer (simulated flash)", "[KB] [KB/s] [rtt ms]"},
+    {"perf", cmdPerf, "Print run time statistics (min, p50, p99, max) or the histogram of one task", "[task|loop|reset]"},
     {"restart", cmdRestart, "Restart the ESP", ""},
+    {"sched", cmdSched, "Print scheduler tasks with run time and deadline statistics", ""},
+    {"stream", cmdStream, "Mirror log messages to telnet", "<on|off>"},
+    {"wsbench", cmdWsBench, "Benchmark WebSocket broadcast: serialize per client against serialize once", ""},
 };
 const int commandsCount = sizeof(commands) / sizeof(commands[0]);
 
@@ -69,6 +102,79 @@ void onTelnetInput(String str) {
   telnetShell();
 }
 
+/**
+ * *******************************************************************
+ * @brief   add log message to telnet output buffer (can be called from any task)
+ *          if the buffer is full, the oldest lines are dropped
+ * @param   msg log message
+ * @return  none
+ * *******************************************************************/
+void telnetStream(const char *msg) {
+  size_t len = strlen(msg);
+  if (len == 0) {
+    return;
+  }
+  if (len > TELNET_TX_BUF_SIZE) {
+    telnetIF.droppedBytes += len - TELNET_TX_BUF_SIZE;
+    msg += len - TELNET_TX_BUF_SIZE;
+    len = TELNET_TX_BUF_SIZE;
+  }
+
+  portENTER_CRITICAL(&txMux);
+
+  // drop oldest bytes - up to the next line end to keep the lines complete
+  if (len > TELNET_TX_BUF_SIZE - txUsed) {
+    size_t drop = len - (TELNET_TX_BUF_SIZE - txUsed);
+    while (drop < txUsed && txBuf[(txTail + drop - 1) % TELNET_TX_BUF_SIZE] != '\n') {
+      drop++;
+    }
+    txTail = (txTail + drop) % TELNET_TX_BUF_SIZE;
+    txUsed -= drop;
+    telnetIF.droppedBytes += drop;
+  }
+
+  size_t head = (txTail + txUsed) % TELNET_TX_BUF_SIZE;
+  size_t part = min(len, TELNET_TX_BUF_SIZE - head);
+  memcpy(&txBuf[head], msg, part);
+  memcpy(txBuf, msg + part, len - part);
+  txUsed += len;
+
+  portEXIT_CRITICAL(&txMux);
+}
+
+/**
+ * *******************************************************************
+ * @brief   write buffered log messages to telnet client (batched)
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+static void telnetFlushStream() {
+  char chunk[TELNET_TX_BATCH];
+  size_t len;
+  bool drained;
+
+  if (txUsed == 0) {
+    return;
+  }
+
+  portENTER_CRITICAL(&txMux);
+  len = min(txUsed, sizeof(chunk));
+  size_t part = min(len, TELNET_TX_BUF_SIZE - txTail);
+  memcpy(chunk, &txBuf[txTail], part);
+  memcpy(chunk + part, txBuf, len - part);
+  txTail = (txTail + len) % TELNET_TX_BUF_SIZE;
+  txUsed -= len;
+  drained = (txUsed == 0);
+  portEXIT_CRITICAL(&txMux);
+
+  if (telnet.isConnected()) {
+    telnet.write((const uint8_t *)chunk, len);
+    if (drained) {
+      telnetShell();
+    }
+  }
+}
+
 /**
  * *******************************************************************
  * @brief   setup function for Telnet
@@ -100,6 +206,9 @@ void cyclicTelnet() {
 
   telnet.loop();
 
+  // write buffered log stream
+  telnetFlushStream();
+
   // process incoming messages
   if (msgAvailable) {
     dispatchCommand(param);
@@ -133,18 +242,16 @@ void cmdInfo(char param[MAX_PAR][MAX_CHAR]) {
   telnet.print(ansi.setFG(ANSI_BRIGHT_WHITE));
   telnet.println("ESP-INFO");
   telnet.print(ansi.reset());
-  telnet.printf("ESP Flash Usage: %s %%\n", EspStrUtil::floatToString((float)ESP.getSketchSize() * 100 / ESP.getFreeSketchSpace(), 1));
-  telnet.printf("ESP Heap Usage: %s %%\n", EspStrUtil::floatToString((float)ESP.getFreeHeap() * 100 / ESP.getHeapSize(), 1));
-  telnet.printf("ESP MAX Alloc Heap: %s KB\n", EspStrUtil::floatToString((float)ESP.getMaxAllocHeap() / 1000.0, 1));
-  telnet.printf("ESP MAX Alloc Heap: %s KB\n", EspStrUtil::floatToString((float)ESP.getMinFreeHeap() / 1000.0, 1));
+  telnet.printf("ESP Flash Usage: %s %%\n", EspStrUtil::floatToString(metrics.flashUsage, 1));
+  telnet.printf("ESP Heap Usage: %s %%\n", EspStrUtil::floatToString(metrics.heapUsage, 1));
+  telnet.printf("ESP MAX Alloc Heap: %s KB\n", EspStrUtil::floatToString((float)metrics.maxAllocHeap / 1000.0, 1));
+  telnet.printf("ESP MIN Free Heap: %s KB\n", EspStrUtil::floatToString((float)metrics.minFreeHeap / 1000.0, 1));
 
   telnet.print(ansi.setFG(ANSI_BRIGHT_WHITE));
   telnet.println("\nRESTART - UPTIME");
   telnet.print(ansi.reset());
-  char tmpMsg[64];
-  getUptime(tmpMsg, sizeof(tmpMsg));
-  telnet.printf("Uptime: %s\n", tmpMsg);
-  telnet.printf("Restart Reason: %s\n", EspSysUtil::RestartReason::get());
+  telnet.printf("Uptime: %s\n", metrics.uptime);
+  telnet.printf("Restart Reason: %s\n", metrics.restartReason);
 
   telnet.print(ansi.setFG(ANSI_BRIGHT_WHITE));
   telnet.println("\nWiFi-INFO");
@@ -153,9 +260,264 @@ void cmdInfo(char param[MAX_PAR][MAX_CHAR]) {
   telnet.printf("WiFi-Signal: %s %%\n", EspStrUtil::intToString(wifi.signal));
   telnet.printf("WiFi-Rssi: %s dbm\n", EspStrUtil::intToString(wifi.rssi));
 
+  telnet.print(ansi.setFG(ANSI_BRIGHT_WHITE));
+  telnet.println("\nTELNET-INFO");
+  telnet.print(ansi.reset());
+  telnet.printf("Log stream dropped: %" PRIu32 " bytes\n", telnetIF.droppedBytes);
+  telnet.printf("Log repeated messages: %" PRIu32 "\n", logData.repeated);
+  telnet.printf("Log suppressed messages: %" PRIu32 "\n", logData.suppressed);
+  telnet.printf("Log forwarded via MQTT: %" PRIu32 " (dropped: %" PRIu32 ")\n", mqttLog.forwarded, mqttLog.dropped);
+  telnet.printf("Log sent to syslog: %" PRIu32 " (dropped: %" PRIu32 ")\n", syslogStat.sent, syslogStat.dropped);
+  telnet.printf("WebUI events: %" PRIu32 " (coalesced: %" PRIu32 ", dropped: %" PRIu32 ")\n", webEventStat.received, webEventStat.coalesced,
+                webEventStat.dropped);
+  telnet.printf("Web assets served: %" PRIu32 " (304: %" PRIu32 ", brotli: %" PRIu32 ", bytes: %" PRIu32 ")\n", webAssetStat.served,
+                webAssetStat.notModified, webAssetStat.brotli, webAssetStat.bytes);
+  const char *bundleState = webAssetsValid() ? "active" : (webAssetStat.mismatch ? "built-in, bundle of another build" : "built-in");
+  telnet.printf("Web asset bundle: %s (updates: %" PRIu32 ", max parallel: %" PRIu32 ", max TTFB: %" PRIu32 " us, heap low: %" PRIu32 ")\n",
+                bundleState, webAssetStat.updates, webAssetStat.maxActive, webAssetStat.ttfbMaxUs, webAssetStat.heapLow);
+
+  telnet.print(ansi.setFG(ANSI_BRIGHT_WHITE));
+  telnet.println("\nJSON-ARENA");
+  telnet.print(ansi.reset());
+  for (const JsonArena *arena = JsonArena::getFirst(); arena != NULL; arena = arena->getNext()) {
+    telnet.printf("%-10s size: %5zu  high water: %5zu  heap fallbacks: %" PRIu32 "\n", arena->getName(), arena->getSize(), arena->getHighWater(),
+                  arena->getFallbacks());
+  }
+  telnet.printf("ESP MAX Alloc Heap (lowest since boot): %s KB\n", EspStrUtil::floatToString(metrics.maxAllocHeapLow / 1000.0, 1));
+
   telnet.println();
 }
 
+/**
+ * *******************************************************************
+ * @brief   telnet command: print filtered log buffer
+ * @param   params received parameters
+ * @return  none
+ * *******************************************************************/
+void cmdLog(char param[MAX_PAR][MAX_CHAR]) {
+  static uint32_t logSeq[MAX_LOG_LINES];
+
+  s_logfilter filter;
+  filter.tags = logTagMask(param[1]);
+  if (strlen(param[2]) > 0) {
+    filter.level = logLevelFromString(param[2]);
+  }
+  int minutes = atoi(param[3]);
+  if (minutes > 0) {
+    filter.from = time(NULL) - minutes * 60;
+  }
+
+  int count = logQuery(filter, logSeq, MAX_LOG_LINES);
+  for (int i = 0; i < count; i++) {
+    telnet.println(logEntryText(logSeq[i]));
+  }
+  telnet.printf("%i entries\n", count);
+}
+
+/**
+ * *******************************************************************
+ * @brief   telnet command: print or set log level per tag
+ * @param   params received parameters
+ * @return  none
+ * *******************************************************************/
+void cmdLogLevel(char param[MAX_PAR][MAX_CHAR]) {
+  if (strlen(param[1]) > 0) {
+    if (!setTagLogLevel(param[1], logLevelFromString(param[2]))) {
+      telnet.println("use: loglevel <tag> <0|E|W|I|D>");
+      return;
+    }
+  }
+  for (int i = 0; i < LOG_LEVEL_TAGS; i++) {
+    telnet.printf("%-10s %i\n", logLevelTags[i], config.log.tag_level[i]);
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   telnet command: print scheduler tasks
+ * @param   params received parameters
+ * @return  none
+ * *******************************************************************/
+void cmdSched(char param[MAX_PAR][MAX_CHAR]) {
+  telnet.println("task       prio period budget(us)     runs max(us) overruns late(ms) misses deferred");
+  for (int i = 0; i < schedTaskCount(); i++) {
+    const s_schedtask *t = schedGetTask(i);
+    char period[8];
+    if (t->periodMs == SCHED_EVENT) {
+      snprintf(period, sizeof(period), "event");
+    } else if (t->periodMs == SCHED_EVERY_LOOP) {
+      snprintf(period, sizeof(period), "loop");
+    } else {
+      snprintf(period, sizeof(period), "%" PRIu32, t->periodMs);
+    }
+    telnet.printf("%-10s %4u %6s %10" PRIu32 " %8" PRIu32 " %7" PRIu32 " %8" PRIu32 " %8" PRIu32 " %6" PRIu32 " %8" PRIu32 "\n", t->name, t->prio,
+                  period, t->budgetUs, t->hist.count, t->hist.maxUs, t->overruns, t->maxLateMs, t->misses, t->deferred);
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   telnet command: metrics sampler statistics and benchmark
+ * @param   params received parameters
+ * @return  none
+ * *******************************************************************/
+void cmdMetrics(char param[MAX_PAR][MAX_CHAR]) {
+  uint32_t directUs, cachedUs;
+  metricsBenchmark(&directUs, &cachedUs);
+
+  telnet.printf("samples: %" PRIu32 " (period: %u ms, last sample: %" PRIu32 " us)\n", metrics.samples, METRICS_SAMPLE_MS, metrics.sampleUs);
+  telnet.printf("direct queries per refresh: %" PRIu32 " us\n", directUs);
+  telnet.printf("snapshot reads per refresh: %" PRIu32 " us\n", cachedUs);
+  telnet.printf("saved per refresh: %d us\n", (int)(directUs - cachedUs));
+}
+
+/**
+ * *******************************************************************
+ * @brief   print one line of run time statistics
+ * @param   name name of the task
+ * @param   hist run time histogram
+ * @return  none
+ * *******************************************************************/
+static void printPerfLine(const char *name, const s_schedhist &hist) {
+  telnet.printf("%-10s %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %8" PRIu32 " %8" PRIu32 "\n", name, hist.count, hist.minUs, schedPercentile(hist, 50),
+                schedPercentile(hist, 99), hist.maxUs);
+}
+
+/**
+ * *******************************************************************
+ * @brief   telnet command: print run time statistics
+ * @param   params received parameters
+ * @return  none
+ * *******************************************************************/
+void cmdPerf(char param[MAX_PAR][MAX_CHAR]) {
+
+  if (!strcmp(param[1], "reset")) {
+    schedResetStats();
+    telnet.println("statistics reset");
+    return;
+  }
+
+  // histogram of one task
+  if (strlen(param[1]) > 0) {
+    const s_schedhist *hist = NULL;
+    if (!strcmp(param[1], "loop")) {
+      hist = schedLoopHist();
+    } else {
+      const s_schedtask *t = schedFindTask(param[1]);
+      hist = t ? &t->hist : NULL;
+    }
+    if (hist == NULL) {
+      telnet.println("use: perf [task|loop|reset]");
+      return;
+    }
+    for (int i = 0; i < SCHED_HIST_BUCKETS; i++) {
+      if (i == SCHED_HIST_BUCKETS - 1) {
+        telnet.printf(">= %6lu us: %" PRIu32 "\n", 1UL << i, hist->bucket[i]);
+      } else {
+        telnet.printf("<  %6lu us: %" PRIu32 "\n", 2UL << i, hist->bucket[i]);
+      }
+    }
+    return;
+  }
+
+  // summary of all tasks
+  telnet.println("task           count  min(us)  p50(us)  p99(us)  max(us)");
+  printPerfLine("loop", *schedLoopHist());
+  for (int i = 0; i < schedTaskCount(); i++) {
+    const s_schedtask *t = schedGetTask(i);
+    printPerfLine(t->name, t->hist);
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   telnet command: OTA writer statistics and benchmark
+ * @param   params received parameters
+ * @return  none
+ * *******************************************************************/
+void cmdOtaBench(char param[MAX_PAR][MAX_CHAR]) {
+  static auto &wdt = EspSysUtil::Wdt::getInstance();
+  size_t sizeKb = strlen(param[1]) ? atoi(param[1]) : 128;
+  uint32_t kbps = strlen(param[2]) ? atoi(param[2]) : 100;
+  uint32_t rttMs = strlen(param[3]) ? atoi(param[3]) : OTA_SIM_RTT_MS;
+  s_otabench result;
+
+  if (otaStat.durationMs > 0) {
+    telnet.printf("last update: %" PRIu32 " bytes in %" PRIu32 " ms (%" PRIu32 " KB/s, flash: %" PRIu32 " ms, hash: %" PRIu32 " ms, wait: %" PRIu32
+                  " ms) %s\n", otaStat.bytes, otaStat.durationMs, otaStat.kbps, otaStat.flashMs, otaStat.hashMs, otaStat.waitMs,
+                  otaStat.error ? otaStat.error : "ok");
+    telnet.printf("SHA-256: %s\n", otaStat.sha256);
+    if (otaDeltaStat.compressed || otaDeltaStat.delta) {
+      telnet.printf("received: %" PRIu32 " bytes (%s%s)\n", otaDeltaStat.received, otaDeltaStat.compressed ? "compressed " : "",
+                    otaDeltaStat.delta ? "delta patch" : "image");
+    }
+    if (otaDeltaStat.delta) {
+      telnet.printf("verify installed firmware: %" PRIu32 " ms\n", otaDeltaStat.verifyMs);
+    }
+  }
+  if (sizeKb == 0 || kbps == 0) {
+    telnet.println("use: otabench [KB] [KB/s] [rtt ms]");
+    return;
+  }
+  telnet.printf("simulated update: %zu KB, network %" PRIu32 " KB/s, rtt %" PRIu32 " ms, erase %u ms/sector\n", sizeKb, kbps, rttMs,
+                OTA_SIM_ERASE_MS);
+  wdt.disable(); // the benchmark blocks the loop for some seconds
+  otaWriterBenchmark(sizeKb * 1024, kbps, rttMs, &result);
+  wdt.enable();
+  telnet.printf("receive, then write: %6" PRIu32 " ms (%" PRIu32 " KB/s)\n", result.serialMs, result.serialKbps);
+  telnet.printf("pipelined:           %6" PRIu32 " ms (%" PRIu32 " KB/s)\n", result.pipeMs, result.pipeKbps);
+}
+
+/**
+ * *******************************************************************
+ * @brief   telnet command: WebSocket broadcast statistics and benchmark
+ * @param   params received parameters
+ * @return  none
+ * *******************************************************************/
+void cmdWsBench(char param[MAX_PAR][MAX_CHAR]) {
+  const int clients[] = {1, 4, 8};
+  char id[16];
+  s_wsbench result;
+
+  // typical element update with 40 values
+  JsonDocument doc;
+  doc["type"] = "updateJSON";
+  for (int i = 0; i < 40; i++) {
+    snprintf(id, sizeof(id), "p01_value_%02d", i);
+    doc[id] = i * 1.5f;
+  }
+
+  telnet.printf("broadcasts: %" PRIu32 ", bytes: %" PRIu32 ", clients: %" PRIu32 ", last: %" PRIu32 " us, max: %" PRIu32 " us\n",
+                wsBroadcastStat.frames, wsBroadcastStat.bytes, wsBroadcastStat.clients, wsBroadcastStat.lastUs, wsBroadcastStat.maxUs);
+  telnet.printf("slow clients: %" PRIu32 ", merged frames: %" PRIu32 ", coalesced values: %" PRIu32 ", flushed: %" PRIu32 "\n",
+                wsBroadcastStat.slowClients, wsBroadcastStat.merged, wsBroadcastStat.coalesced, wsBroadcastStat.flushed);
+  telnet.printf("benchmark frame: %zu bytes\n", measureJson(doc));
+  telnet.println("clients  per client(us)  heap(B)  once(us)  heap(B)");
+  for (int i = 0; i < 3; i++) {
+    wsBroadcastBenchmark(doc, clients[i], &result);
+    telnet.printf("%7d  %14" PRIu32 "  %7" PRIu32 "  %8" PRIu32 "  %7" PRIu32 "\n", clients[i], result.perClientUs, result.perClientHeap,
+                  result.onceUs, result.onceHeap);
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   telnet command: enable/disable log stream
+ * @param   params received parameters
+ * @return  none
+ * *******************************************************************/
+void cmdStream(char param[MAX_PAR][MAX_CHAR]) {
+  if (!strcmp(param[1], "on")) {
+    telnetIF.serialStream = true;
+    telnet.println("log stream enabled");
+  } else if (!strcmp(param[1], "off")) {
+    telnetIF.serialStream = false;
+    telnet.println("log stream disabled");
+  } else {
+    telnet.println("use: stream <on|off>");
+  }
+}
+
 /**
  * *******************************************************************
  * @brief   telnet command: clear output
@@ -0,0 +1,345 @@
+#include <basics.h>
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+#include <webAssets.h>
+
+/* S E T T I N G S ****************************************************/
+#define WEB_ASSETS_CACHE_IMMUTABLE "public, max-age=31536000, immutable" // hashed urls
+#define WEB_ASSETS_CACHE_REVALIDATE "no-cache"                         // index and unhashed urls
+#define WEB_ASSETS_MAX 16                                              // max number of assets in the bundle
+#define WEB_ASSETS_SECTOR 4096                                         // flash sector size (erase unit)
+
+/* D E C L A R A T I O N S ****************************************************/
+s_webassetstat webAssetStat;
+
+static const char *TAG = "WEB"; // LOG TAG
+static const esp_partition_t *partition = NULL;
+static esp_partition_mmap_handle_t mapHandle;
+static const uint8_t *bundle = NULL;             // memory mapped asset partition
+static volatile bool bundleValid = false;        // bundle is mapped and verified
+static bool serveIndexPage = false;              // also serve index.html
+static char etags[WEB_ASSETS_MAX][2][20];        // strong ETag per asset and encoding
+static size_t uploadErased = 0;                  // number of erased bytes during update
+static bool uploadError = false;                 // update failed
+static bool uploadBusy = false;                  // update refused - responses in progress
+
+static portMUX_TYPE assetMux = portMUX_INITIALIZER_UNLOCKED; // bundleValid and number of active responses
+
+/**
+ * *******************************************************************
+ * @brief   get asset index of the bundle
+ * @param   idx index of the asset
+ * @return  asset entry
+ * *******************************************************************/
+static inline const s_webasset &webAsset(int idx) { return ((const s_webasset *)(bundle + sizeof(s_webassetheader)))[idx]; }
+
+/**
+ * *******************************************************************
+ * @brief   unmap the asset partition
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+static void webAssetsUnmap() {
+  bundleValid = false;
+  if (bundle != NULL) {
+    esp_partition_munmap(mapHandle);
+    bundle = NULL;
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   map the asset partition and verify the bundle
+ * @param   none
+ * @return  true if the bundle is valid
+ * *******************************************************************/
+static bool webAssetsMap() {
+
+  webAssetsUnmap();
+  if (partition == NULL) {
+    return false;
+  }
+  const void *ptr;
+  if (esp_partition_mmap(partition, 0, partition->size, ESP_PARTITION_MMAP_DATA, &ptr, &mapHandle) != ESP_OK) {
+    ESP_LOGE(TAG, "asset partition could not be mapped");
+    return false;
+  }
+  bundle = (const uint8_t *)ptr;
+
+  const s_webassetheader *header = (const s_webassetheader *)bundle;
+  if (header->magic != WEB_ASSETS_MAGIC || header->version != WEB_ASSETS_VERSION || header->count > WEB_ASSETS_MAX ||
+      header->size > partition->size || header->size < sizeof(s_webassetheader) + header->count * sizeof(s_webasset)) {
+    ESP_LOGW(TAG, "no valid asset bundle - using built-in web files");
+    webAssetsUnmap();
+    return false;
+  }
+  if (esp_rom_crc32_le(0, bundle + sizeof(s_webassetheader), header->size - sizeof(s_webassetheader)) != header->crc) {
+    ESP_LOGE(TAG, "asset bundle crc error - using built-in web files");
+    webAssetsUnmap();
+    return false;
+  }
+  if (WEB_ASSETS_BUNDLE_CRC != 0 && header->crc != WEB_ASSETS_BUNDLE_CRC) {
+    // e.g. firmware updated by OTA but the assets partition still contains the bundle of the old firmware
+    ESP_LOGW(TAG, "asset bundle does not belong to the firmware - using built-in web files");
+    webAssetStat.mismatch++;
+    webAssetsUnmap();
+    return false;
+  }
+  for (int i = 0; i < header->count; i++) {
+    const s_webasset &asset = webAsset(i);
+    if (asset.gzOffset + asset.gzLen > header->size || asset.brOffset + asset.brLen > header->size) {
+      ESP_LOGE(TAG, "asset bundle index error - using built-in web files");
+      webAssetsUnmap();
+      return false;
+    }
+    snprintf(etags[i][0], sizeof(etags[i][0]), "\"%.11s-gz\"", asset.hash);
+    snprintf(etags[i][1], sizeof(etags[i][1]), "\"%.11s-br\"", asset.hash);
+  }
+
+  bundleValid = true;
+  ESP_LOGI(TAG, "asset bundle: %u files, %" PRIu32 " bytes", header->count, header->size);
+  return true;
+}
+
+/**
+ * *******************************************************************
+ * @brief   check if the asset bundle is used
+ * @param   none
+ * @return  true if the bundle is valid
+ * *******************************************************************/
+bool webAssetsValid() { return bundleValid; }
+
+/**
+ * *******************************************************************
+ * @brief   find asset for url
+ * @param   url requested url
+ * @param   immutable set to true if the hashed url was requested
+ * @return  index of the asset (-1 if not found)
+ * *******************************************************************/
+static int webAssetFind(const String &url, bool *immutable) {
+  if (!bundleValid) {
+    return -1;
+  }
+  const s_webassetheader *header = (const s_webassetheader *)bundle;
+  for (int i = 0; i < header->count; i++) {
+    const s_webasset &asset = webAsset(i);
+    if (!asset.immutable && !serveIndexPage) {
+      continue;
+    }
+    if (url == asset.path) {
+      *immutable = asset.immutable;
+      return i;
+    }
+    if (url == asset.alias) {
+      *immutable = false; // the original url has to be revalidated
+      return i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * *******************************************************************
+ * @brief   check if the browser already has the actual version
+ * @param   request web request
+ * @param   etag ETag of the actual version
+ * @return  true if the ETag is in If-None-Match
+ * *******************************************************************/
+static bool webAssetCached(AsyncWebServerRequest *request, const char *etag) {
+  if (!request->hasHeader("If-None-Match")) {
+    return false;
+  }
+  const String &value = request->getHeader("If-None-Match")->value();
+  return value == "*" || value.indexOf(etag) >= 0;
+}
+
+/**
+ * *******************************************************************
+ * @brief   send asset directly from the mapped partition
+ * @param   request web request
+ * @param   idx index of the asset
+ * @param   immutable url with content hash
+ * @return  none
+ * *******************************************************************/
+static void webAssetSend(AsyncWebServerRequest *request, int idx, bool immutable) {
+  const s_webasset &asset = webAsset(idx);
+
+  bool useBrotli = false;
+  if (asset.brLen > 0 && request->hasHeader("Accept-Encoding")) {
+    useBrotli = request->getHeader("Accept-Encoding")->value().indexOf("br") >= 0;
+  }
+  const char *etag = etags[idx][useBrotli ? 1 : 0];
+
+  AsyncWebServerResponse *response;
+  if (webAssetCached(request, etag)) {
+    response = request->beginResponse(304);
+    webAssetStat.notModified++;
+  } else {
+    // the response reads from the mapped partition - count it before the bundle can be replaced (see webAssetsUpload)
+    portENTER_CRITICAL(&assetMux);
+    bool valid = bundleValid;
+    if (valid) {
+      webAssetStat.active++;
+      webAssetStat.maxActive = webAssetStat.active > webAssetStat.maxActive ? webAssetStat.active : webAssetStat.maxActive;
+    }
+    portEXIT_CRITICAL(&assetMux);
+    if (!valid) {
+      request->send(404); // bundle has been replaced in the meantime
+      return;
+    }
+    // content is read from flash in the size of the send buffer - no copy of the file in the heap
+    const uint8_t *content = bundle + (useBrotli ? asset.brOffset : asset.gzOffset);
+    size_t len = useBrotli ? asset.brLen : asset.gzLen;
+    uint32_t start = micros();
+    response = request->beginResponse(asset.mime, len, [content, len, start](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+      if (!bundleValid) {
+        return 0; // bundle is being updated
+      }
+      if (index == 0) {
+        uint32_t ttfb = micros() - start;
+        webAssetStat.ttfbMaxUs = ttfb > webAssetStat.ttfbMaxUs ? ttfb : webAssetStat.ttfbMaxUs;
+      }
+      size_t n = len - index < maxLen ? len - index : maxLen;
+      memcpy(buffer, content + index, n);
+      uint32_t freeHeap = ESP.getFreeHeap();
+      webAssetStat.heapLow = (webAssetStat.heapLow == 0 || freeHeap < webAssetStat.heapLow) ? freeHeap : webAssetStat.heapLow;
+      return n;
+    });
+    request->onDisconnect([]() { // response finished or aborted
+      portENTER_CRITICAL(&assetMux);
+      webAssetStat.active--;
+      portEXIT_CRITICAL(&assetMux);
+    });
+    response->addHeader("Content-Encoding", useBrotli ? "br" : "gzip"); // gzip is supported by all browsers
+    webAssetStat.served++;
+    webAssetStat.brotli += useBrotli ? 1 : 0;
+    webAssetStat.bytes += len;
+  }
+  response->addHeader("ETag", etag);
+  response->addHeader("Cache-Control", immutable ? WEB_ASSETS_CACHE_IMMUTABLE : WEB_ASSETS_CACHE_REVALIDATE);
+  response->addHeader("Vary", "Accept-Encoding");
+  request->send(response);
+}
+
+/**
+ * *******************************************************************
+ * @brief   web handler for the assets of the bundle
+ * *******************************************************************/
+class WebAssetHandler : public AsyncWebHandler {
+public:
+  bool canHandle(AsyncWebServerRequest *request) const override {
+    bool immutable;
+    return request->method() == HTTP_GET && webAssetFind(request->url(), &immutable) >= 0;
+  }
+
+  void handleRequest(AsyncWebServerRequest *request) override {
+    bool immutable;
+    int idx = webAssetFind(request->url(), &immutable);
+    if (idx < 0) {
+      request->send(404); // bundle has been replaced in the meantime
+      return;
+    }
+    webAssetSend(request, idx, immutable);
+  }
+};
+
+/**
+ * *******************************************************************
+ * @brief   write uploaded bundle into the asset partition
+ * @param   request web request
+ * @param   index offset of the data
+ * @param   data received data
+ * @param   len length of the data
+ * @param   final last chunk
+ * @return  none
+ * *******************************************************************/
+static void webAssetsUpload(AsyncWebServerRequest *request, size_t index, uint8_t *data, size_t len, bool final) {
+
+  if (index == 0) {
+    // active responses read from the mapped partition - it must not be unmapped and overwritten.
+    // Check and invalidate in one step, so that no response can start in between.
+    portENTER_CRITICAL(&assetMux);
+    uint32_t active = webAssetStat.active;
+    uploadBusy = active > 0;
+    if (!uploadBusy) {
+      bundleValid = false;
+    }
+    portEXIT_CRITICAL(&assetMux);
+    if (uploadBusy) {
+      ESP_LOGW(TAG, "asset bundle update refused - %" PRIu32 " responses in progress", active);
+      return;
+    }
+    ESP_LOGI(TAG, "asset bundle update started");
+    webAssetsUnmap(); // new requests are served by the built-in web files
+    uploadErased = 0;
+    uploadError = (partition == NULL);
+  }
+  if (uploadBusy || uploadError) {
+    return;
+  }
+  if (index + len > partition->size) {
+    ESP_LOGE(TAG, "asset bundle too large");
+    uploadError = true;
+    return;
+  }
+
+  // erase sector by sector in front of the data (erasing the whole partition would block too long)
+  while (uploadErased < index + len) {
+    if (esp_partition_erase_range(partition, uploadErased, WEB_ASSETS_SECTOR) != ESP_OK) {
+      uploadError = true;
+      return;
+    }
+    uploadErased += WEB_ASSETS_SECTOR;
+  }
+  if (esp_partition_write(partition, index, data, len) != ESP_OK) {
+    uploadError = true;
+    return;
+  }
+
+  if (final) {
+    uploadError = !webAssetsMap();
+    if (!uploadError) {
+      webAssetStat.updates++;
+      ESP_LOGI(TAG, "asset bundle update finished");
+    }
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   register handlers for the asset bundle
+ * @param   server web server
+ * @param   serveIndex also serve index.html (the page itself)
+ * @return  none
+ * *******************************************************************/
+void webAssetsSetup(AsyncWebServer &server, bool serveIndex) {
+
+  serveIndexPage = serveIndex;
+  partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, WEB_ASSETS_PARTITION);
+  if (partition == NULL) {
+    ESP_LOGE(TAG, "asset partition not found");
+  }
+  webAssetsMap();
+
+  server.addHandler(new WebAssetHandler());
+
+  // update of the asset bundle, independent of the firmware: curl -F "file=@webassets.bin" http://<ip>/assets
+  server.on(
+      "/assets", HTTP_POST,
+      [](AsyncWebServerRequest *request) {
+        if (config.auth.enable && !request->authenticate(config.auth.user, config.auth.password)) {
+          return request->requestAuthentication();
+        }
+        if (uploadBusy) {
+          request->send(503, "text/plain", "asset bundle in use - try again");
+          return;
+        }
+        request->send(uploadError ? 400 : 200, "text/plain", uploadError ? "asset bundle update failed" : "OK");
+      },
+      [](AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool final) {
+        if (config.auth.enable && !request->authenticate(config.auth.user, config.auth.password)) {
+          return;
+        }
+        webAssetsUpload(request, index, data, len, final);
+      });
+}
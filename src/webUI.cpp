@@ -1,10 +1,19 @@
 #include <LittleFS.h>
 #include <Update.h>
+#include <atomic>
 #include <basics.h>
 #include <language.h>
 #include <message.h>
+#include <otaDelta.h>
+#include <otaWriter.h>
+#include <prometheus.h>
+#include <webAssets.h>
 #include <webUI.h>
 #include <webUIupdates.h>
+#include <wsBroadcast.h>
+
+/* S E T T I N G S ****************************************************/
+#define WEB_EVENT_SLOTS 8 // max number of pending web element events (with different element ids)
 
 /* P R O T O T Y P E S ********************************************************/
 void webCallback(const char *elementId, const char *value);
@@ -18,16 +27,184 @@ EspWebUI webUI(80);
 static const char *TAG = "WEB"; // LOG TAG
 static bool webInitDone = false;
 static bool onLoadRequest = false;
+static bool otaUploadFailed = false;
+
+// slot of the web event queue
+// producer: AsyncTCP task (FREE -> WRITING -> READY, or READY -> WRITING -> READY to coalesce)
+// consumer: loop task (READY -> READING -> FREE)
+enum webEventState : uint8_t { EVENT_FREE, EVENT_WRITING, EVENT_READY, EVENT_READING };
+struct s_webEvent {
+  std::atomic<uint8_t> state;
+  uint32_t seq; // sequence number to process events in order of arrival
+  char elementID[32];
+  char value[256];
+};
 
-static char webCallbackElementID[32];
-static char webCallbackValue[256];
-static bool webCallbackAvailable = false;
+static s_webEvent webEvents[WEB_EVENT_SLOTS];
+static uint32_t webEventSeq = 0; // only used by producer
+s_webevents webEventStat;
 
 s_example example; // example values
 
 static auto &wdt = EspSysUtil::Wdt::getInstance();
 static auto &ota = EspSysUtil::OTA::getInstance();
 
+/**
+ * *******************************************************************
+ * @brief   add web element event to queue (called from AsyncTCP task)
+ * @details a pending event with the same element id gets the new value
+ *          and moves to the end of the queue - events are processed in
+ *          the order of their latest value, also across element ids
+ * @param   elementID, value
+ * @return  none
+ * *******************************************************************/
+static void webEventPush(const char *elementID, const char *value) {
+
+  webEventStat.received++;
+
+  // coalesce with pending event of the same element - latest value wins and is processed after the events received before it
+  for (int i = 0; i < WEB_EVENT_SLOTS; i++) {
+    s_webEvent &e = webEvents[i];
+    uint8_t expected = EVENT_READY;
+    if (e.state.load(std::memory_order_acquire) == EVENT_READY && strcmp(e.elementID, elementID) == 0 &&
+        e.state.compare_exchange_strong(expected, EVENT_WRITING, std::memory_order_acquire)) {
+      e.seq = webEventSeq++;
+      snprintf(e.value, sizeof(e.value), "%s", value);
+      e.state.store(EVENT_READY, std::memory_order_release);
+      webEventStat.coalesced++;
+      return;
+    }
+  }
+
+  // use free slot
+  for (int i = 0; i < WEB_EVENT_SLOTS; i++) {
+    s_webEvent &e = webEvents[i];
+    uint8_t expected = EVENT_FREE;
+    if (e.state.compare_exchange_strong(expected, EVENT_WRITING, std::memory_order_acquire)) {
+      e.seq = webEventSeq++;
+      snprintf(e.elementID, sizeof(e.elementID), "%s", elementID);
+      snprintf(e.value, sizeof(e.value), "%s", value);
+      e.state.store(EVENT_READY, std::memory_order_release);
+      return;
+    }
+  }
+
+  webEventStat.dropped++;
+}
+
+/**
+ * *******************************************************************
+ * @brief   process all pending web element events (called from loop task)
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+static void webEventProcess() {
+  static char elementID[32];
+  static char value[256];
+
+  for (int n = 0; n < WEB_EVENT_SLOTS; n++) {
+    // oldest pending event
+    int oldest = -1;
+    for (int i = 0; i < WEB_EVENT_SLOTS; i++) {
+      if (webEvents[i].state.load(std::memory_order_acquire) == EVENT_READY &&
+          (oldest < 0 || (int32_t)(webEvents[i].seq - webEvents[oldest].seq) < 0)) {
+        oldest = i;
+      }
+    }
+    if (oldest < 0) {
+      return;
+    }
+
+    // copy event and release slot before the callback is executed
+    s_webEvent &e = webEvents[oldest];
+    uint8_t expected = EVENT_READY;
+    if (!e.state.compare_exchange_strong(expected, EVENT_READING, std::memory_order_acquire)) {
+      continue; // producer is just updating the value - try again
+    }
+    memcpy(elementID, e.elementID, sizeof(elementID));
+    memcpy(value, e.value, sizeof(value));
+    e.state.store(EVENT_FREE, std::memory_order_release);
+
+    webCallback(elementID, value);
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   show OTA status in the webUI
+ * @param   otaState state of the update
+ * @param   msg progress in % or error message
+ * @return  none
+ * *******************************************************************/
+static void webOtaStatus(EspWebUI::otaStatus otaState, const char *msg) {
+  switch (otaState) {
+  case EspWebUI::OTA_BEGIN:
+    webUI.wsUpdateWebText("p00_ota_upd_err", msg, false);
+    webUI.wsUpdateWebDialog("ota_update_failed_dialog", "open");
+    break;
+  case EspWebUI::OTA_PROGRESS:
+    webUI.wsUpdateOTAprogress(msg);
+    break;
+  case EspWebUI::OTA_FINISH:
+    webUI.wsUpdateOTAprogress("100");
+    webUI.wsUpdateWebDialog("ota_update_done_dialog", "open");
+    break;
+  case EspWebUI::OTA_ERROR:
+    webUI.wsUpdateWebText("p00_ota_upd_err", msg, false);
+    webUI.wsUpdateWebDialog("ota_update_failed_dialog", "open");
+    break;
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   firmware upload of the webUI (called from AsyncTCP task)
+ * @details the data is passed to the pipelined OTA writer, so the next
+ *          chunk is received while the previous one is written to flash.
+ *          Compressed images and delta patches are unpacked on the fly.
+ * @param   request, index, data, len, final upload handler parameters
+ * @return  none
+ * *******************************************************************/
+static void webOtaUpload(AsyncWebServerRequest *request, size_t index, uint8_t *data, size_t len, bool final) {
+  static int lastProgress = -1;
+  char progress[8];
+
+  if (index == 0) {
+    lastProgress = -1;
+    otaUploadFailed = !otaStreamBegin(0);
+    if (otaUploadFailed) {
+      webOtaStatus(EspWebUI::OTA_ERROR, otaStat.error);
+      return;
+    }
+    ota.setActive(true);
+    request->onDisconnect([]() {
+      otaStreamAbort(); // connection lost during upload (nothing to do if the update has finished)
+      ota.setActive(false);
+    });
+  }
+  if (otaUploadFailed) {
+    return;
+  }
+  if (!otaStreamWrite(data, len)) {
+    otaUploadFailed = true;
+    webOtaStatus(EspWebUI::OTA_ERROR, otaStat.error);
+    otaStreamAbort();
+    ota.setActive(false);
+    return;
+  }
+  int percent = request->contentLength() ? (int)((index + len) * 100 / request->contentLength()) : 0;
+  if (percent != lastProgress) {
+    lastProgress = percent;
+    snprintf(progress, sizeof(progress), "%d", percent);
+    webOtaStatus(EspWebUI::OTA_PROGRESS, progress);
+  }
+  if (final) {
+    otaUploadFailed = !otaStreamEnd();
+    webOtaStatus(otaUploadFailed ? EspWebUI::OTA_ERROR : EspWebUI::OTA_FINISH, otaStat.error);
+    ota.setActive(false);
+  }
+}
+
 /**
  * *******************************************************************
  * @brief   cyclic call for webUI - creates all webUI elements
@@ -36,25 +213,7 @@ static auto &ota = EspSysUtil::OTA::getInstance();
  * *******************************************************************/
 void webUISetup() {
 
-  webUI.setCallbackOta([](EspWebUI::otaStatus otaState, const char *msg) {
-    switch (otaState) {
-    case EspWebUI::OTA_BEGIN:
-      webUI.wsUpdateWebText("p00_ota_upd_err", msg, false);
-      webUI.wsUpdateWebDialog("ota_update_failed_dialog", "open");
-      break;
-    case EspWebUI::OTA_PROGRESS:
-      webUI.wsUpdateOTAprogress(msg);
-      break;
-    case EspWebUI::OTA_FINISH:
-      webUI.wsUpdateOTAprogress("100");
-      webUI.wsUpdateWebDialog("ota_update_done_dialog", "open");
-      break;
-    case EspWebUI::OTA_ERROR:
-      webUI.wsUpdateWebText("p00_ota_upd_err", msg, false);
-      webUI.wsUpdateWebDialog("ota_update_failed_dialog", "open");
-      break;
-    }
-  });
+  webUI.setCallbackOta(webOtaStatus);
 
   webUI.setCallbackUpload([](EspWebUI::uploadStatus uploadState, const char *msg) {
     switch (uploadState) {
@@ -76,16 +235,35 @@ void webUISetup() {
   // callback for reload
   webUI.setCallbackReload([]() { onLoadRequest = true; });
 
-  // callback for web elements - copy elementID and value and call webCallback in cyclic loop
-  webUI.setCallbackWebElement([](const char *elementID, const char *elementValue) {
-    snprintf(webCallbackElementID, sizeof(webCallbackElementID), "%s", elementID);
-    snprintf(webCallbackValue, sizeof(webCallbackValue), "%s", elementValue);
-    webCallbackAvailable = true;
-  });
+  // callback for web elements - add elementID and value to queue and call webCallback in cyclic loop
+  webUI.setCallbackWebElement([](const char *elementID, const char *elementValue) { webEventPush(elementID, elementValue); });
 
   webUI.setCredentials(config.auth.user, config.auth.password);
   webUI.setAuthentication(config.auth.enable);
 
+  // precompressed assets with content hash and ETag (registered before the default handlers)
+  // index.html is left to EspWebUI if authentication is active (login handling)
+  webAssetsSetup(webUI.getServer(), !config.auth.enable);
+
+  // Prometheus metrics
+  prometheusSetup(webUI.getServer());
+
+  // firmware upload with the pipelined OTA writer (registered before the handler of EspWebUI)
+  webUI.getServer().on(
+      "/update", HTTP_POST,
+      [](AsyncWebServerRequest *request) {
+        if (config.auth.enable && !request->authenticate(config.auth.user, config.auth.password)) {
+          return request->requestAuthentication();
+        }
+        request->send(otaUploadFailed ? 500 : 200, "text/plain", otaUploadFailed ? "update failed" : "OK");
+      },
+      [](AsyncWebServerRequest *request, const String &filename, size_t index, uint8_t *data, size_t len, bool final) {
+        if (config.auth.enable && !request->authenticate(config.auth.user, config.auth.password)) {
+          return;
+        }
+        webOtaUpload(request, index, data, len, final);
+      });
+
   webUI.begin();
 } // END SETUP
 
@@ -109,11 +287,11 @@ void webUICyclic() {
   // handling of update webUI elements
   webUIupdates();
 
+  // merged updates for slow WebSocket clients
+  wsBroadcastCyclic();
+
   // handling of callback infomation
-  if (webCallbackAvailable) {
-    webCallback(webCallbackElementID, webCallbackValue);
-    webCallbackAvailable = false;
-  }
+  webEventProcess();
 
   webInitDone = true; // init done
 }
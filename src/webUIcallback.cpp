@@ -2,10 +2,39 @@
 #include <basics.h>
 #include <message.h>
 #include <webUI.h>
+#include <webUIelements.h>
 #include <webUIupdates.h>
 
 static const char *TAG = "WEB"; // LOG TAG
 
+/**
+ * *******************************************************************
+ * @brief   FNV-1a hash of element id (constexpr - usable as case label)
+ * @details the switch in webCallback() is resolved by the compiler, a hash
+ *          collision of two element ids is reported as duplicate case value
+ * @param   str element id
+ * @param   hash start value
+ * @return  hash value
+ * *******************************************************************/
+static constexpr uint32_t webIdHash(const char *str, uint32_t hash = 2166136261UL) {
+  return *str ? webIdHash(str + 1, (hash ^ (uint8_t)*str) * 16777619UL) : hash;
+}
+
+/**
+ * *******************************************************************
+ * @brief   case label of an element id in webCallback()
+ * @details the switch selects the case by hash, the id itself is compared
+ *          once for the selected case - an unknown id can have the same hash
+ *          as a known one
+ * @param   id element id
+ * *******************************************************************/
+#define WEB_ID_CASE(id)                                                                                                                              \
+  case webIdHash(id):                                                                                                                                \
+    if (strcmp(elementId, id) != 0) {                                                                                                                \
+      ESP_LOGD(TAG, "unknown element id: %s", elementId);                                                                                            \
+      break;                                                                                                                                         \
+    }
+
 /**
  * *******************************************************************
  * @brief   callback function for web elements
@@ -15,222 +44,287 @@ static const char *TAG = "WEB"; // LOG TAG
  * *******************************************************************/
 void webCallback(const char *elementId, const char *value) {
 
-  ESP_LOGD(TAG, "Received - Element ID: %s = %s", elementId, value);
+  const uint32_t id = webIdHash(elementId);
+
+  // visible page - reported cyclic by every browser, so it is not logged
+  if (id != webIdHash("p00_page")) {
+    ESP_LOGD(TAG, "Received - Element ID: %s = %s", elementId, value);
+  }
+
+  // log level per tag: cfg_logger_tag_level_<TAG>
+  if (strncmp(elementId, "cfg_logger_tag_level_", 21) == 0) {
+    setTagLogLevel(elementId + 21, strtoul(value, NULL, 10));
+    return;
+  }
+
+  switch (id) {
+
+  // ------------------------------------------------------------------
+  // webUI internal
+  // ------------------------------------------------------------------
+
+  // visible page
+  WEB_ID_CASE("p00_page")
+    webSetVisiblePage(value);
+    break;
+  // browser does not know an element index - send the dictionary again
+  WEB_ID_CASE("p00_elements_reset")
+    webElementsReset(strtoul(value, NULL, 10));
+    break;
 
   // ------------------------------------------------------------------
   // GitHub / Version
   // ------------------------------------------------------------------
 
   // Github Check Version
-  if (strcmp(elementId, "check_git_version") == 0 || strcmp(elementId, "p11_check_git_btn") == 0) {
+  WEB_ID_CASE("check_git_version")
     requestGitHubVersion();
-  }
+    break;
+  WEB_ID_CASE("p11_check_git_btn")
+    requestGitHubVersion();
+    break;
   // Github Update
-  if (strcmp(elementId, "p00_update_btn") == 0) {
+  WEB_ID_CASE("p00_update_btn")
     requestGitHubUpdate();
-  }
+    break;
   // OTA-Confirm
-  if (strcmp(elementId, "p00_ota_confirm_btn") == 0) {
+  WEB_ID_CASE("p00_ota_confirm_btn")
     webUI.wsUpdateWebDialog("ota_update_done_dialog", "close");
     EspSysUtil::RestartReason::saveLocal("ota update");
     yield();
     delay(1000);
     yield();
     ESP.restart();
-  }
+    break;
 
   // ------------------------------------------------------------------
   // Settings callback
   // ------------------------------------------------------------------
 
   // WiFi
-  if (strcmp(elementId, "cfg_wifi_enable") == 0) {
+  WEB_ID_CASE("cfg_wifi_enable")
     config.wifi.enable = EspStrUtil::stringToBool(value);
-  }
-  if (strcmp(elementId, "cfg_wifi_hostname") == 0) {
+    break;
+  WEB_ID_CASE("cfg_wifi_hostname")
     snprintf(config.wifi.hostname, sizeof(config.wifi.hostname), value);
-  }
-  if (strcmp(elementId, "cfg_wifi_ssid") == 0) {
+    break;
+  WEB_ID_CASE("cfg_wifi_ssid")
     snprintf(config.wifi.ssid, sizeof(config.wifi.ssid), value);
-  }
-  if (strcmp(elementId, "cfg_wifi_password") == 0) {
+    break;
+  WEB_ID_CASE("cfg_wifi_password")
     snprintf(config.wifi.password, sizeof(config.wifi.password), value);
-  }
-  if (strcmp(elementId, "cfg_wifi_static_ip") == 0) {
+    break;
+  WEB_ID_CASE("cfg_wifi_static_ip")
     config.wifi.static_ip = EspStrUtil::stringToBool(value);
-  }
-  if (strcmp(elementId, "cfg_wifi_ipaddress") == 0) {
+    break;
+  WEB_ID_CASE("cfg_wifi_ipaddress")
     snprintf(config.wifi.ipaddress, sizeof(config.wifi.ipaddress), value);
-  }
-  if (strcmp(elementId, "cfg_wifi_subnet") == 0) {
+    break;
+  WEB_ID_CASE("cfg_wifi_subnet")
     snprintf(config.wifi.subnet, sizeof(config.wifi.subnet), value);
-  }
-  if (strcmp(elementId, "cfg_wifi_gateway") == 0) {
+    break;
+  WEB_ID_CASE("cfg_wifi_gateway")
     snprintf(config.wifi.gateway, sizeof(config.wifi.gateway), value);
-  }
-  if (strcmp(elementId, "cfg_wifi_dns") == 0) {
+    break;
+  WEB_ID_CASE("cfg_wifi_dns")
     snprintf(config.wifi.dns, sizeof(config.wifi.dns), value);
-  }
+    break;
 
   // Ethernet
-  if (strcmp(elementId, "cfg_eth_enable") == 0) {
+  WEB_ID_CASE("cfg_eth_enable")
     config.eth.enable = EspStrUtil::stringToBool(value);
-  }
-  if (strcmp(elementId, "cfg_eth_hostname") == 0) {
+    break;
+  WEB_ID_CASE("cfg_eth_hostname")
     snprintf(config.eth.hostname, sizeof(config.eth.hostname), value);
-  }
-  if (strcmp(elementId, "cfg_eth_gpio_sck") == 0) {
+    break;
+  WEB_ID_CASE("cfg_eth_gpio_sck")
     config.eth.gpio_sck = strtoul(value, NULL, 10);
-  }
-  if (strcmp(elementId, "cfg_eth_gpio_mosi") == 0) {
+    break;
+  WEB_ID_CASE("cfg_eth_gpio_mosi")
     config.eth.gpio_mosi = strtoul(value, NULL, 10);
-  }
-  if (strcmp(elementId, "cfg_eth_gpio_miso") == 0) {
+    break;
+  WEB_ID_CASE("cfg_eth_gpio_miso")
     config.eth.gpio_miso = strtoul(value, NULL, 10);
-  }
-  if (strcmp(elementId, "cfg_eth_gpio_cs") == 0) {
+    break;
+  WEB_ID_CASE("cfg_eth_gpio_cs")
     config.eth.gpio_cs = strtoul(value, NULL, 10);
-  }
-  if (strcmp(elementId, "cfg_eth_gpio_irq") == 0) {
+    break;
+  WEB_ID_CASE("cfg_eth_gpio_irq")
     config.eth.gpio_irq = strtoul(value, NULL, 10);
-  }
-  if (strcmp(elementId, "cfg_eth_gpio_rst") == 0) {
+    break;
+  WEB_ID_CASE("cfg_eth_gpio_rst")
     config.eth.gpio_rst = strtoul(value, NULL, 10);
-  }
-  if (strcmp(elementId, "cfg_eth_static_ip") == 0) {
+    break;
+  WEB_ID_CASE("cfg_eth_static_ip")
     config.eth.static_ip = EspStrUtil::stringToBool(value);
-  }
-  if (strcmp(elementId, "cfg_eth_ipaddress") == 0) {
+    break;
+  WEB_ID_CASE("cfg_eth_ipaddress")
     snprintf(config.eth.ipaddress, sizeof(config.eth.ipaddress), value);
-  }
-  if (strcmp(elementId, "cfg_eth_subnet") == 0) {
+    break;
+  WEB_ID_CASE("cfg_eth_subnet")
     snprintf(config.eth.subnet, sizeof(config.eth.subnet), value);
-  }
-  if (strcmp(elementId, "cfg_eth_gateway") == 0) {
+    break;
+  WEB_ID_CASE("cfg_eth_gateway")
     snprintf(config.eth.gateway, sizeof(config.eth.gateway), value);
-  }
-  if (strcmp(elementId, "cfg_eth_dns") == 0) {
+    break;
+  WEB_ID_CASE("cfg_eth_dns")
     snprintf(config.eth.dns, sizeof(config.eth.dns), value);
-  }
+    break;
 
   // Authentication
-  if (strcmp(elementId, "cfg_auth_enable") == 0) {
+  WEB_ID_CASE("cfg_auth_enable")
     config.auth.enable = EspStrUtil::stringToBool(value);
     webUI.setAuthentication(config.auth.enable);
-  }
-  if (strcmp(elementId, "cfg_auth_user") == 0) {
+    break;
+  WEB_ID_CASE("cfg_auth_user")
     snprintf(config.auth.user, sizeof(config.auth.user), "%s", value);
     webUI.setCredentials(config.auth.user, config.auth.password);
-  }
-  if (strcmp(elementId, "cfg_auth_password") == 0) {
+    break;
+  WEB_ID_CASE("cfg_auth_password")
     snprintf(config.auth.password, sizeof(config.auth.password), "%s", value);
     webUI.setCredentials(config.auth.user, config.auth.password);
-  }
+    break;
 
   // NTP-Server
-  if (strcmp(elementId, "cfg_ntp_enable") == 0) {
+  WEB_ID_CASE("cfg_ntp_enable")
     config.ntp.enable = EspStrUtil::stringToBool(value);
-  }
-  if (strcmp(elementId, "cfg_ntp_server") == 0) {
+    break;
+  WEB_ID_CASE("cfg_ntp_server")
     snprintf(config.ntp.server, sizeof(config.ntp.server), "%s", value);
-  }
-  if (strcmp(elementId, "cfg_ntp_tz") == 0) {
+    break;
+  WEB_ID_CASE("cfg_ntp_tz")
     snprintf(config.ntp.tz, sizeof(config.ntp.tz), "%s", value);
-  }
+    break;
 
   // MQTT
-  if (strcmp(elementId, "cfg_mqtt_enable") == 0) {
+  WEB_ID_CASE("cfg_mqtt_enable")
     config.mqtt.enable = EspStrUtil::stringToBool(value);
-  }
-  if (strcmp(elementId, "cfg_mqtt_server") == 0) {
+    break;
+  WEB_ID_CASE("cfg_mqtt_server")
     snprintf(config.mqtt.server, sizeof(config.mqtt.server), "%s", value);
-  }
-  if (strcmp(elementId, "cfg_mqtt_port") == 0) {
+    break;
+  WEB_ID_CASE("cfg_mqtt_port")
     config.mqtt.port = strtoul(value, NULL, 10);
-  }
-  if (strcmp(elementId, "cfg_mqtt_topic") == 0) {
+    break;
+  WEB_ID_CASE("cfg_mqtt_topic")
     snprintf(config.mqtt.topic, sizeof(config.mqtt.topic), "%s", value);
-  }
-  if (strcmp(elementId, "cfg_mqtt_user") == 0) {
+    break;
+  WEB_ID_CASE("cfg_mqtt_user")
     snprintf(config.mqtt.user, sizeof(config.mqtt.user), "%s", value);
-  }
-  if (strcmp(elementId, "cfg_mqtt_password") == 0) {
+    break;
+  WEB_ID_CASE("cfg_mqtt_password")
     snprintf(config.mqtt.password, sizeof(config.mqtt.password), "%s", value);
-  }
-  if (strcmp(elementId, "cfg_mqtt_ha_enable") == 0) {
+    break;
+  WEB_ID_CASE("cfg_mqtt_ha_enable")
     config.mqtt.ha_enable = EspStrUtil::stringToBool(value);
-  }
-  if (strcmp(elementId, "cfg_mqtt_ha_topic") == 0) {
+    break;
+  WEB_ID_CASE("cfg_mqtt_ha_topic")
     snprintf(config.mqtt.ha_topic, sizeof(config.mqtt.ha_topic), "%s", value);
-  }
-  if (strcmp(elementId, "cfg_mqtt_ha_device") == 0) {
+    break;
+  WEB_ID_CASE("cfg_mqtt_ha_device")
     snprintf(config.mqtt.ha_device, sizeof(config.mqtt.ha_device), "%s", value);
-  }
+    break;
 
   // Language
-  if (strcmp(elementId, "cfg_lang") == 0) {
+  WEB_ID_CASE("cfg_lang")
     config.lang = strtoul(value, NULL, 10);
     updateAllElements();
-  }
+    break;
 
   // Restart (and save)
-  if (strcmp(elementId, "restartAction") == 0) {
+  WEB_ID_CASE("restartAction")
     EspSysUtil::RestartReason::saveLocal("webUI command");
     configSaveToFile();
     delay(1000);
     ESP.restart();
-  }
+    break;
 
   // Logger
-  if (strcmp(elementId, "cfg_logger_enable") == 0) {
+  WEB_ID_CASE("cfg_logger_enable")
     config.log.enable = EspStrUtil::stringToBool(value);
-  }
-  if (strcmp(elementId, "cfg_logger_level") == 0) {
+    break;
+  WEB_ID_CASE("cfg_logger_level")
     config.log.level = strtoul(value, NULL, 10);
     setLogLevel(config.log.level);
     clearLogBuffer();
     webUI.wsUpdateWebLog("", "clr_log"); // clear log
-  }
-  if (strcmp(elementId, "cfg_logger_order") == 0) {
+    break;
+  WEB_ID_CASE("cfg_logger_order")
     config.log.order = strtoul(value, NULL, 10);
     webUI.wsUpdateWebLog("", "clr_log"); // clear log
     webReadLogBuffer();
-  }
-  if (strcmp(elementId, "p10_log_clr_btn") == 0) {
+    break;
+  WEB_ID_CASE("cfg_logger_mqtt_enable")
+    config.log.mqtt_enable = EspStrUtil::stringToBool(value);
+    break;
+  WEB_ID_CASE("cfg_logger_mqtt_level")
+    config.log.mqtt_level = strtoul(value, NULL, 10);
+    break;
+  WEB_ID_CASE("cfg_syslog_enable")
+    config.syslog.enable = EspStrUtil::stringToBool(value);
+    break;
+  WEB_ID_CASE("cfg_syslog_server")
+    snprintf(config.syslog.server, sizeof(config.syslog.server), "%s", value);
+    break;
+  WEB_ID_CASE("cfg_syslog_port")
+    config.syslog.port = strtoul(value, NULL, 10);
+    break;
+  WEB_ID_CASE("cfg_syslog_level")
+    config.syslog.level = strtoul(value, NULL, 10);
+    break;
+  WEB_ID_CASE("p10_log_clr_btn")
     clearLogBuffer();
     webUI.wsUpdateWebLog("", "clr_log"); // clear log
-  }
-  if (strcmp(elementId, "p10_log_refresh_btn") == 0) {
+    break;
+  WEB_ID_CASE("p10_log_refresh_btn")
     webReadLogBuffer();
-  }
+    break;
+  WEB_ID_CASE("p10_log_filter_tag")
+    webLogFilterTags(value);
+    webReadLogBuffer();
+    break;
+  WEB_ID_CASE("p10_log_filter_level")
+    webLogFilterLevel(value);
+    webReadLogBuffer();
+    break;
+  WEB_ID_CASE("p10_log_filter_time")
+    webLogFilterTime(strtoul(value, NULL, 10));
+    webReadLogBuffer();
+    break;
 
   // ------------------------------------------------------------------
   // Control Example callback
   // ------------------------------------------------------------------
 
   // OPMODE-Example
-  if (strcmp(elementId, "p02_opmode_man") == 0) {
+  WEB_ID_CASE("p02_opmode_man")
     ESP_LOGI(TAG, "OPMODE: Manual");
     example.opmode = 0;
-  } else if (strcmp(elementId, "p02_opmode_auto") == 0) {
+    break;
+  WEB_ID_CASE("p02_opmode_auto")
     ESP_LOGI(TAG, "OPMODE: Auto");
     example.opmode = 1;
-  }
+    break;
 
   // Dropdown-Example
-  if (strcmp(elementId, "p02_option") == 0) {
+  WEB_ID_CASE("p02_option")
     ESP_LOGI(TAG, "Dropdown-Value: %s", value);
-  }
+    break;
 
   // Input-Example
-  if (strcmp(elementId, "p02_number_1") == 0) {
+  WEB_ID_CASE("p02_number_1")
     ESP_LOGI(TAG, "Input-Value: %s", value);
     example.setTemp = atoi(value);
-  }
+    break;
 
   // Range-Example
-  if (strcmp(elementId, "p02_range_1_value") == 0) {
+  WEB_ID_CASE("p02_range_1_value")
     ESP_LOGI(TAG, "Range-Value: %s", value);
     example.actTemp = atoi(value);
+    break;
+
+  default:
+    ESP_LOGD(TAG, "unknown element id: %s", elementId);
+    break;
   }
 }
\ No newline at end of file
@@ -0,0 +1,427 @@
+#include <basics.h>
+#include <webUI.h>
+#include <webUIelements.h>
+#include <wsBroadcast.h>
+
+/* S E T T I N G S ****************************************************/
+#define WEB_ELEMENTS_MAX 128         // max number of tracked element ids
+#define WEB_ELEMENTS_JSON_OVERHEAD 4 // quotes of the id, colon and comma of one JSON element
+#define WEB_ELEMENTS_JSON_HEADER 21  // {"type":"updateJSON"} of one JSON update
+
+// element updates with element indices instead of ids: 0 = plain "updateJSON", 1 = compact JSON frames, 2 = binary frames
+#ifndef WEB_ELEMENTS_COMPACT
+#define WEB_ELEMENTS_COMPACT 2
+#endif
+
+// record types of the binary element frame
+#define WEB_REC_CLIENT 1   // id of the WebSocket client (varint) - no key, the frame is the dictionary of this browser
+#define WEB_REC_DICT 2     // element index (byte) + element id (string)
+#define WEB_REC_INT 3      // zigzag varint
+#define WEB_REC_FLOAT 4    // float32, little endian
+#define WEB_REC_STRING 5   // string: length (varint) + UTF-8 chars
+#define WEB_REC_ICON 6     // icon class without "i_" (string)
+#define WEB_REC_NAMED 0x80 // flag: the key is the element id (string) instead of the index
+
+/* D E C L A R A T I O N S ****************************************************/
+s_webelements webElements;
+
+// last sent value of one element (hash 0 = unused slot)
+struct s_webelement {
+  uint32_t id;      // hash of the element id
+  uint32_t value;   // hash of the last sent value
+  const char *name; // element id (must be a static string)
+  bool valid;       // value has been sent since the last invalidate
+  bool announced;   // element index has been sent to the connected browsers
+};
+
+static const int ELEMENT_UNCHANGED = -1; // value has not changed
+static const int ELEMENT_UNTRACKED = -2; // value has to be sent, but the registry is full
+
+static s_webelement elements[WEB_ELEMENTS_MAX];
+static_assert(WEB_ELEMENTS_MAX <= 256, "element index of the binary frame is one byte");
+static int pendingCount = 0;                 // number of changed elements in the current JSON buffer
+static uint32_t pendingJson = 0;             // size of the current update as plain JSON
+static uint32_t savedBytes = 0;              // bytes saved in the current minute
+static uint64_t jsonBytes = 0;               // size of all sent updates as plain JSON
+static uint64_t compactBytes = 0;            // size of all sent updates as compact frames
+static uint32_t dictClients[WS_CLIENTS_MAX]; // WebSocket clients that have received the element dictionary
+static muTimer minuteTimer = muTimer();
+
+/**
+ * *******************************************************************
+ * @brief   FNV-1a hash
+ * @param   data, len
+ * @param   hash start value (to chain multiple calls)
+ * @return  hash value
+ * *******************************************************************/
+static uint32_t fnv1a(const void *data, size_t len, uint32_t hash = 2166136261UL) {
+  const uint8_t *p = (const uint8_t *)data;
+  for (size_t i = 0; i < len; i++) {
+    hash = (hash ^ p[i]) * 16777619UL;
+  }
+  return hash;
+}
+
+/**
+ * *******************************************************************
+ * @brief   check if element value has changed since the last update
+ * @param   id element id
+ * @param   valueHash hash of the new value
+ * @param   valueLen length of the value in the JSON message
+ * @return  index of the element, ELEMENT_UNCHANGED or ELEMENT_UNTRACKED
+ * *******************************************************************/
+static int webElementChanged(const char *id, uint32_t valueHash, size_t valueLen) {
+
+  uint32_t idHash = fnv1a(id, strlen(id));
+  if (idHash == 0) {
+    idHash = 1;
+  }
+  size_t jsonLen = strlen(id) + valueLen + WEB_ELEMENTS_JSON_OVERHEAD;
+
+  // open addressing with linear probing (ids with the same hash use different slots)
+  int slot = ELEMENT_UNTRACKED;
+  for (int i = 0; i < WEB_ELEMENTS_MAX; i++) {
+    int idx = (idHash + i) % WEB_ELEMENTS_MAX;
+    s_webelement &e = elements[idx];
+    if (e.id == idHash && (e.name == id || strcmp(e.name, id) == 0)) {
+      if (e.valid && e.value == valueHash) {
+        webElements.skipped++;
+        savedBytes += jsonLen;
+        return ELEMENT_UNCHANGED;
+      }
+      e.value = valueHash;
+      e.valid = true;
+      slot = idx;
+      break;
+    }
+    if (e.id == 0) {
+      e.id = idHash;
+      e.value = valueHash;
+      e.name = id;
+      e.valid = true;
+      e.announced = false;
+      slot = idx;
+      break;
+    }
+  }
+  // if the table is full, the element is not tracked and always sent
+  webElements.sent++;
+  pendingCount++;
+  pendingJson += jsonLen;
+  return slot;
+}
+
+/**
+ * *******************************************************************
+ * @brief   add element value to JSON buffer
+ * @details compact frame: {"type":"elements","d":[idx,"id",...],"v":[idx,value,...]}
+ *          "d" announces new element indices, "j" contains untracked elements.
+ *          With WEB_ELEMENTS_COMPACT 2 the frame is sent as binary frame (serializeElements).
+ * @param   doc JSON buffer
+ * @param   slot index of the element (or ELEMENT_UNTRACKED)
+ * @param   id element id
+ * @param   value new value
+ * @return  none
+ * *******************************************************************/
+template <typename T> static void webElementPut(JsonDocument &doc, int slot, const char *id, T value) {
+#if WEB_ELEMENTS_COMPACT
+  if (slot == ELEMENT_UNTRACKED) {
+    doc["j"][id] = value;
+    return;
+  }
+  if (!elements[slot].announced) {
+    doc["d"].add(slot);
+    doc["d"].add(elements[slot].name);
+    elements[slot].announced = true;
+  }
+  doc["v"].add(slot);
+  doc["v"].add(value);
+#else
+  webUI.addJson(doc, id, value);
+#endif
+}
+
+/**
+ * *******************************************************************
+ * @brief   start a new JSON buffer for element updates
+ * @param   doc JSON buffer
+ * @return  none
+ * *******************************************************************/
+void webElementsBegin(JsonDocument &doc) {
+#if WEB_ELEMENTS_COMPACT
+  doc.clear();
+  doc["type"] = "elements";
+#else
+  webUI.initJsonBuffer(doc);
+#endif
+  pendingCount = 0;
+  pendingJson = WEB_ELEMENTS_JSON_HEADER;
+}
+
+/**
+ * *******************************************************************
+ * @brief   send the element dictionary to clients that do not know it
+ * @details the dictionary contains all indices and the id of the client,
+ *          so the browser can request it again (p00_elements_reset).
+ *          Elements that are added later are announced in the update frames.
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+static void webElementsAnnounce() {
+  uint32_t ids[WS_CLIENTS_MAX];
+  uint32_t known[WS_CLIENTS_MAX] = {0};
+  int count = wsClientIds(ids, WS_CLIENTS_MAX);
+  JsonDocument dict;
+
+  for (int i = 0; i < count; i++) {
+    known[i] = ids[i];
+    bool found = false;
+    for (int k = 0; k < WS_CLIENTS_MAX && !found; k++) {
+      found = (dictClients[k] == ids[i]);
+    }
+    if (found) {
+      continue;
+    }
+    if (dict.isNull()) {
+      dict["type"] = "elements";
+      for (int slot = 0; slot < WEB_ELEMENTS_MAX; slot++) {
+        if (elements[slot].id != 0) {
+          dict["d"].add(slot);
+          dict["d"].add(elements[slot].name);
+        }
+      }
+    }
+    dict["c"] = ids[i];
+    wsSendJSON(ids[i], dict);
+  }
+  memcpy(dictClients, known, sizeof(dictClients));
+}
+
+/**
+ * *******************************************************************
+ * @brief   send JSON buffer if it contains changed elements
+ * @param   doc JSON buffer
+ * @return  none
+ * *******************************************************************/
+void webElementsSend(JsonDocument &doc) {
+
+  if (minuteTimer.cycleTrigger(60000)) {
+    webElements.savedPerMinute = savedBytes;
+    savedBytes = 0;
+  }
+
+  if (pendingCount > 0) {
+    jsonBytes += pendingJson;
+    size_t frameLen = measureElements(doc);
+    compactBytes += frameLen ? frameLen : measureJson(doc);
+    if (jsonBytes > 0) {
+      webElements.compactRatio = 100 - (uint32_t)(compactBytes * 100 / jsonBytes);
+    }
+#if WEB_ELEMENTS_COMPACT
+    webElementsAnnounce();
+#endif
+    wsBroadcastJSON(doc);
+    pendingCount = 0;
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   forget all sent values, e.g. if a new browser has connected
+ * @details element indices are kept - a new browser gets them with its
+ *          own dictionary
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+void webElementsInvalidate() {
+  for (int i = 0; i < WEB_ELEMENTS_MAX; i++) {
+    elements[i].valid = false;
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   browser has received an unknown element index
+ * @param   client id of the WebSocket client (0 = unknown)
+ * @return  none
+ * *******************************************************************/
+void webElementsReset(uint32_t client) {
+  for (int i = 0; i < WS_CLIENTS_MAX; i++) {
+    if (client == 0 || dictClients[i] == client) {
+      dictClients[i] = 0; // dictionary is sent again with the next update
+    }
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   add element to JSON buffer - only if its value has changed
+ * @param   doc JSON buffer
+ * @param   id element id (must be a static string)
+ * @param   value new value
+ * @return  none
+ * *******************************************************************/
+void webElementAdd(JsonDocument &doc, const char *id, const char *value) {
+  size_t len = strlen(value);
+  int slot = webElementChanged(id, fnv1a(value, len), len + 2);
+  if (slot != ELEMENT_UNCHANGED) {
+    webElementPut(doc, slot, id, value);
+  }
+}
+
+void webElementAdd(JsonDocument &doc, const char *id, int value) {
+  int slot = webElementChanged(id, fnv1a(&value, sizeof(value)), snprintf(NULL, 0, "%i", value));
+  if (slot != ELEMENT_UNCHANGED) {
+    webElementPut(doc, slot, id, value);
+  }
+}
+
+void webElementAdd(JsonDocument &doc, const char *id, long value) {
+  int slot = webElementChanged(id, fnv1a(&value, sizeof(value)), snprintf(NULL, 0, "%ld", value));
+  if (slot != ELEMENT_UNCHANGED) {
+    webElementPut(doc, slot, id, value);
+  }
+}
+
+void webElementAdd(JsonDocument &doc, const char *id, float value) {
+  int slot = webElementChanged(id, fnv1a(&value, sizeof(value)), snprintf(NULL, 0, "%g", value));
+  if (slot != ELEMENT_UNCHANGED) {
+    webElementPut(doc, slot, id, value);
+  }
+}
+
+/* B I N A R Y   F R A M E ****************************************************/
+// output of a binary frame - only counts the bytes if there is no buffer
+struct s_elementwriter {
+  uint8_t *out;
+  size_t size;
+  size_t len;
+
+  void byte(uint8_t b) {
+    if (len < size) {
+      out[len] = b;
+    }
+    len++;
+  }
+  void varint(uint64_t v) {
+    while (v >= 0x80) {
+      byte((uint8_t)(v | 0x80));
+      v >>= 7;
+    }
+    byte((uint8_t)v);
+  }
+  void string(const char *s) {
+    size_t n = strlen(s);
+    varint(n);
+    for (size_t i = 0; i < n; i++) {
+      byte((uint8_t)s[i]);
+    }
+  }
+};
+
+/**
+ * *******************************************************************
+ * @brief   write one element value as typed record
+ * @param   w output
+ * @param   idx element index
+ * @param   id element id of an untracked element (NULL = key is the index)
+ * @param   value element value
+ * @return  false if the value type has no record (bool, null, ...)
+ * *******************************************************************/
+static bool writeElement(s_elementwriter &w, int idx, const char *id, JsonVariantConst value) {
+  uint8_t flag = id ? WEB_REC_NAMED : 0;
+  if (value.is<long long>()) {
+    w.byte(WEB_REC_INT | flag);
+  } else if (value.is<float>()) {
+    w.byte(WEB_REC_FLOAT | flag);
+  } else if (value.is<const char *>()) {
+    w.byte((strncmp(value.as<const char *>(), "i_", 2) ? WEB_REC_STRING : WEB_REC_ICON) | flag);
+  } else {
+    return false;
+  }
+  if (id) {
+    w.string(id);
+  } else {
+    w.byte((uint8_t)idx);
+  }
+
+  if (value.is<long long>()) {
+    long long v = value.as<long long>();
+    w.varint(((uint64_t)v << 1) ^ (uint64_t)(v >> 63)); // zigzag: small negative values stay short
+  } else if (value.is<float>()) {
+    float f = value.as<float>();
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    for (int i = 0; i < 4; i++) {
+      w.byte((uint8_t)(bits >> (8 * i)));
+    }
+  } else {
+    const char *s = value.as<const char *>();
+    w.string(strncmp(s, "i_", 2) ? s : s + 2);
+  }
+  return true;
+}
+
+/**
+ * *******************************************************************
+ * @brief   write compact element frame as binary frame
+ * @details the frame starts with WEB_ELEMENTS_FRAME, followed by records
+ *          of type (byte), key (element index or id) and typed value -
+ *          see WEB_REC_... and decodeElements in user.js
+ * @param   doc compact element frame (webElementsBegin/webElementAdd)
+ * @param   w output
+ * @return  false if the frame can not be written as binary frame
+ * *******************************************************************/
+static bool writeElements(JsonDocument &doc, s_elementwriter &w) {
+
+  if (WEB_ELEMENTS_COMPACT < 2 || strcmp(doc["type"] | "", "elements")) {
+    return false;
+  }
+  w.byte(WEB_ELEMENTS_FRAME);
+  if (!doc["c"].isNull()) {
+    w.byte(WEB_REC_CLIENT);
+    w.varint(doc["c"].as<uint32_t>());
+  }
+  JsonArrayConst d = doc["d"];
+  for (size_t i = 0; i + 1 < d.size(); i += 2) {
+    w.byte(WEB_REC_DICT);
+    w.byte(d[i].as<uint8_t>());
+    w.string(d[i + 1] | "");
+  }
+  JsonArrayConst v = doc["v"];
+  for (size_t i = 0; i + 1 < v.size(); i += 2) {
+    if (!writeElement(w, v[i].as<int>(), NULL, v[i + 1])) {
+      return false;
+    }
+  }
+  for (JsonPairConst p : doc["j"].as<JsonObjectConst>()) {
+    if (!writeElement(w, 0, p.key().c_str(), p.value())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * *******************************************************************
+ * @brief   size of the binary frame of element updates
+ * @param   doc compact element frame
+ * @return  size in bytes, 0 = no binary frame (sent as JSON)
+ * *******************************************************************/
+size_t measureElements(JsonDocument &doc) {
+  s_elementwriter w = {NULL, 0, 0};
+  return writeElements(doc, w) ? w.len : 0;
+}
+
+/**
+ * *******************************************************************
+ * @brief   write binary frame of element updates
+ * @param   doc compact element frame
+ * @param   output buffer
+ * @param   size size of the buffer (see measureElements)
+ * @return  number of written bytes, 0 = no binary frame (sent as JSON)
+ * *******************************************************************/
+size_t serializeElements(JsonDocument &doc, uint8_t *output, size_t size) {
+  s_elementwriter w = {output, size, 0};
+  return writeElements(doc, w) && w.len <= size ? w.len : 0;
+}
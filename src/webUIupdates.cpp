@@ -2,17 +2,41 @@
 #include <EspStrUtil.h>
 #include <basics.h>
 #include <github.h>
+#include <jsonArena.h>
 #include <language.h>
 #include <message.h>
+#include <metrics.h>
+#include <scheduler.h>
 #include <webUI.h>
+#include <webUIelements.h>
 #include <webUIupdates.h>
+#include <wsBroadcast.h>
 
 /* S E T T I N G S ****************************************************/
 #define WEBUI_SLOW_REFRESH_TIME_MS 3000
 #define WEBUI_FAST_REFRESH_TIME_MS 100
+#define WEBUI_PAGE_TIMEOUT_MS 12000 // page is hidden if no client has reported it within this time
+#define WEBUI_MAX_PAGES 16          // max number of pages (tab1 ... tab15)
+
+// JSON memory for the logger output (worst case: all MAX_LOG_LINES entries with MAX_LOG_ENTRY bytes)
+// every entry is copied into the document: string node of 8 bytes + text (8 byte aligned in the arena) = 136 bytes,
+// plus one variant pool of ArduinoJson (256 slots of 16 bytes on 32 bit) and the pool list: 31.3 KB for 200 entries
+#define WEBUI_LOG_ARENA_SIZE (MAX_LOG_LINES * (MAX_LOG_ENTRY + 8) + 256 * 16 + 64)
+
+// pages with cyclic updates (number of the tab in index.html)
+#define PAGE_DASHBOARD 1
+#define PAGE_TABLE 3
+#define PAGE_SYSTEM 9
+#define PAGE_PERF 13
+
+// rows of the performance table (scheduler tasks)
+#define PERF_ROWS 8
+#define PERF_COLUMNS 6
+static const char *perfRows[PERF_ROWS] = {"loop", "ota", "webui", "message", "telnet", "config", "wifi", "mqtt"};
 
 /* P R O T O T Y P E S ********************************************************/
 void updateSystemInfoElements();
+void updatePerfElements();
 
 /* D E C L A R A T I O N S ****************************************************/
 
@@ -22,14 +46,18 @@ static muTimer otaProgessTimer = muTimer(); // timer to refresh other values
 
 static char tmpMessage[300] = {'\0'};
 static bool refreshRequest = false;
-static JsonDocument jsonDoc;
-static int logLine, logIdx = 0;
+static JsonArena webArena("web", 2048);    // JSON memory for element updates
+static JsonArena logArena("weblog", WEBUI_LOG_ARENA_SIZE); // JSON memory for logger output
+static JsonDocument jsonDoc(&webArena);
 static bool logReadActive = false;
-JsonDocument jsonLog;
+static s_logfilter logFilter;    // filter for webUI logger
+static int logFilterMinutes = 0; // show only entries of the last x minutes (0 = all)
+static uint32_t pageSeenMs[WEBUI_MAX_PAGES]; // last time a client has reported the page as visible
+static bool pageRefresh = false;             // a page has become visible
+JsonDocument jsonLog(&logArena);
 static const char *TAG = "WEB"; // LOG TAG
 static auto &ota = EspSysUtil::OTA::getInstance();
 static auto &wdt = EspSysUtil::Wdt::getInstance();
-GithubRelease ghLatestRelease;
 GithubReleaseInfo ghReleaseInfo;
 
 /**
@@ -45,7 +73,8 @@ GithubReleaseInfo ghReleaseInfo;
  * *******************************************************************/
 void updateAllElements() {
 
-  refreshRequest = true; // start combined json refresh
+  refreshRequest = true;   // start combined json refresh
+  webElementsInvalidate(); // send all elements to the new browser
 
   webUI.wsUpdateWebLanguage(LANG::CODE[config.lang]);
 
@@ -54,6 +83,34 @@ void updateAllElements() {
   }
 }
 
+/**
+ * *******************************************************************
+ * @brief   check if page is visible in any connected browser
+ * @param   page number of the tab
+ * @return  true if the page is visible
+ * *******************************************************************/
+static bool webPageVisible(int page) { return pageSeenMs[page] != 0 && millis() - pageSeenMs[page] < WEBUI_PAGE_TIMEOUT_MS; }
+
+/**
+ * *******************************************************************
+ * @brief   set visible page reported by the browser
+ * @param   page id of the visible tab, e.g. "tab9" ("none" if the browser is hidden)
+ * @return  none
+ * *******************************************************************/
+void webSetVisiblePage(const char *page) {
+  if (strncmp(page, "tab", 3) != 0) {
+    return;
+  }
+  int idx = atoi(page + 3);
+  if (idx <= 0 || idx >= WEBUI_MAX_PAGES) {
+    return;
+  }
+  if (!webPageVisible(idx)) {
+    pageRefresh = true; // send values of the new page without waiting for the next cycle
+  }
+  pageSeenMs[idx] = millis();
+}
+
 /**
  * *******************************************************************
  * @brief   update System informations
@@ -62,86 +119,88 @@ void updateAllElements() {
  * *******************************************************************/
 void updateSystemInfoElements() {
 
-  refreshNetworkInfo();
+  webElementsBegin(jsonDoc);
+
+  // WiFi and ETH icons in the header (visible on every page)
+  if (!config.wifi.enable) {
+    webElementAdd(jsonDoc, "p00_wifi_icon", "");
+  } else if (!WiFi.isConnected()) {
+    webElementAdd(jsonDoc, "p00_wifi_icon", "i_wifi_nok");
+  } else if (wifi.rssi < -80) {
+    webElementAdd(jsonDoc, "p00_wifi_icon", "i_wifi_1");
+  } else if (wifi.rssi < -70) {
+    webElementAdd(jsonDoc, "p00_wifi_icon", "i_wifi_2");
+  } else if (wifi.rssi < -60) {
+    webElementAdd(jsonDoc, "p00_wifi_icon", "i_wifi_3");
+  } else {
+    webElementAdd(jsonDoc, "p00_wifi_icon", "i_wifi_4");
+  }
 
-  webUI.initJsonBuffer(jsonDoc);
+  if (!config.eth.enable) {
+    webElementAdd(jsonDoc, "p00_eth_icon", "");
+  } else {
+    webElementAdd(jsonDoc, "p00_eth_icon", eth.connected ? "i_eth_ok" : "i_eth_nok");
+  }
+
+  // the remaining elements are only needed if the system page is visible
+  if (!webPageVisible(PAGE_SYSTEM)) {
+    webElementsSend(jsonDoc);
+    return;
+  }
 
   // WiFi information
   if (config.wifi.enable) {
-    webUI.addJson(jsonDoc, "p09_wifi_ip", wifi.ipAddress);
+    webElementAdd(jsonDoc, "p09_wifi_ip", wifi.ipAddress);
     snprintf(tmpMessage, sizeof(tmpMessage), "%i %%", wifi.signal);
-    webUI.addJson(jsonDoc, "p09_wifi_signal", tmpMessage);
+    webElementAdd(jsonDoc, "p09_wifi_signal", tmpMessage);
     snprintf(tmpMessage, sizeof(tmpMessage), "%ld dbm", wifi.rssi);
-    webUI.addJson(jsonDoc, "p09_wifi_rssi", tmpMessage);
-
-    if (!WiFi.isConnected()) {
-      webUI.addJson(jsonDoc, "p00_wifi_icon", "i_wifi_nok");
-    } else if (wifi.rssi < -80) {
-      webUI.addJson(jsonDoc, "p00_wifi_icon", "i_wifi_1");
-    } else if (wifi.rssi < -70) {
-      webUI.addJson(jsonDoc, "p00_wifi_icon", "i_wifi_2");
-    } else if (wifi.rssi < -60) {
-      webUI.addJson(jsonDoc, "p00_wifi_icon", "i_wifi_3");
-    } else {
-      webUI.addJson(jsonDoc, "p00_wifi_icon", "i_wifi_4");
-    }
-
+    webElementAdd(jsonDoc, "p09_wifi_rssi", tmpMessage);
   } else {
-    webUI.addJson(jsonDoc, "p00_wifi_icon", "");
-    webUI.addJson(jsonDoc, "p09_wifi_ip", "-.-.-.-");
-    webUI.addJson(jsonDoc, "p09_wifi_signal", "0");
-    webUI.addJson(jsonDoc, "p09_wifi_rssi", "0 dbm");
+    webElementAdd(jsonDoc, "p09_wifi_ip", "-.-.-.-");
+    webElementAdd(jsonDoc, "p09_wifi_signal", "0");
+    webElementAdd(jsonDoc, "p09_wifi_rssi", "0 dbm");
   }
 
-  webUI.addJson(jsonDoc, "p09_eth_ip", strlen(eth.ipAddress) ? eth.ipAddress : "-.-.-.-");
-  webUI.addJson(jsonDoc, "p09_eth_status", eth.connected ? WEB_TXT::CONNECTED[config.lang] : WEB_TXT::NOT_CONNECTED[config.lang]);
+  webElementAdd(jsonDoc, "p09_eth_ip", strlen(eth.ipAddress) ? eth.ipAddress : "-.-.-.-");
+  webElementAdd(jsonDoc, "p09_eth_status", eth.connected ? WEB_TXT::CONNECTED[config.lang] : WEB_TXT::NOT_CONNECTED[config.lang]);
 
   // ETH information
-  if (config.eth.enable) {
-    if (eth.connected) {
-      webUI.addJson(jsonDoc, "p00_eth_icon", "i_eth_ok");
-      snprintf(tmpMessage, sizeof(tmpMessage), "%d Mbps", eth.linkSpeed);
-      webUI.addJson(jsonDoc, "p09_eth_link_speed", tmpMessage);
-      webUI.addJson(jsonDoc, "p09_eth_full_duplex", eth.fullDuplex ? WEB_TXT::FULL_DUPLEX[config.lang] : "---");
-
-    } else {
-      webUI.addJson(jsonDoc, "p00_eth_icon", "i_eth_nok");
-      webUI.addJson(jsonDoc, "p09_eth_link_speed", "---");
-      webUI.addJson(jsonDoc, "p09_eth_full_duplex", "---");
-    }
+  if (config.eth.enable && eth.connected) {
+    snprintf(tmpMessage, sizeof(tmpMessage), "%d Mbps", eth.linkSpeed);
+    webElementAdd(jsonDoc, "p09_eth_link_speed", tmpMessage);
+    webElementAdd(jsonDoc, "p09_eth_full_duplex", eth.fullDuplex ? WEB_TXT::FULL_DUPLEX[config.lang] : "---");
   } else {
-    webUI.addJson(jsonDoc, "p00_eth_icon", "");
-    webUI.addJson(jsonDoc, "p09_eth_link_speed", "---");
-    webUI.addJson(jsonDoc, "p09_eth_full_duplex", "---");
+    webElementAdd(jsonDoc, "p09_eth_link_speed", "---");
+    webElementAdd(jsonDoc, "p09_eth_full_duplex", "---");
   }
 
   // MQTT Status
-  webUI.addJson(jsonDoc, "p09_mqtt_status", config.mqtt.enable ? WEB_TXT::ACTIVE[config.lang] : WEB_TXT::INACTIVE[config.lang]);
-  webUI.addJson(jsonDoc, "p09_mqtt_connection", mqttIsConnected() ? WEB_TXT::CONNECTED[config.lang] : WEB_TXT::NOT_CONNECTED[config.lang]);
+  webElementAdd(jsonDoc, "p09_mqtt_status", config.mqtt.enable ? WEB_TXT::ACTIVE[config.lang] : WEB_TXT::INACTIVE[config.lang]);
+  webElementAdd(jsonDoc, "p09_mqtt_connection", mqttIsConnected() ? WEB_TXT::CONNECTED[config.lang] : WEB_TXT::NOT_CONNECTED[config.lang]);
 
   if (mqttGetLastError() != nullptr) {
-    webUI.addJson(jsonDoc, "p09_mqtt_last_err", mqttGetLastError());
+    webElementAdd(jsonDoc, "p09_mqtt_last_err", mqttGetLastError());
   } else {
-    webUI.addJson(jsonDoc, "p09_mqtt_last_err", "---");
+    webElementAdd(jsonDoc, "p09_mqtt_last_err", "---");
   }
 
   // ESP informations
-  webUI.addJson(jsonDoc, "p09_esp_flash_usage", ESP.getSketchSize() * 100.0f / ESP.getFreeSketchSpace());
-  webUI.addJson(jsonDoc, "p09_esp_heap_usage", (ESP.getHeapSize() - ESP.getFreeHeap()) * 100.0f / ESP.getHeapSize());
-  webUI.addJson(jsonDoc, "p09_esp_maxallocheap", ESP.getMaxAllocHeap() / 1000.0f);
-  webUI.addJson(jsonDoc, "p09_esp_minfreeheap", ESP.getMinFreeHeap() / 1000.0f);
+  webElementAdd(jsonDoc, "p09_esp_flash_usage", metrics.flashUsage);
+  webElementAdd(jsonDoc, "p09_esp_heap_usage", metrics.heapUsage);
+  webElementAdd(jsonDoc, "p09_esp_maxallocheap", metrics.maxAllocHeap / 1000.0f);
+  webElementAdd(jsonDoc, "p09_esp_minfreeheap", metrics.minFreeHeap / 1000.0f);
+  webElementAdd(jsonDoc, "p09_ws_saved", (int)webElements.savedPerMinute);
+  webElementAdd(jsonDoc, "p09_ws_compact", (int)webElements.compactRatio);
 
   // Uptime
-  char uptimeStr[64];
-  getUptime(uptimeStr, sizeof(uptimeStr));
-  webUI.addJson(jsonDoc, "p09_uptime", uptimeStr);
+  webElementAdd(jsonDoc, "p09_uptime", metrics.uptime);
 
   // Date
-  webUI.addJson(jsonDoc, "p09_act_date", EspStrUtil::getDateString());
+  webElementAdd(jsonDoc, "p09_act_date", EspStrUtil::getDateString());
   // act Time
-  webUI.addJson(jsonDoc, "p09_act_time", EspStrUtil::getTimeString());
+  webElementAdd(jsonDoc, "p09_act_time", EspStrUtil::getTimeString());
 
-  webUI.wsUpdateWebJSON(jsonDoc);
+  webElementsSend(jsonDoc);
 }
 
 /**
@@ -162,12 +221,12 @@ void updateSystemInfoElementsStatic() {
   webUI.addJson(jsonDoc, "p09_sw_date", EspStrUtil::getBuildDateTime());
 
   // restart reason
-  webUI.addJson(jsonDoc, "p09_restart_reason", EspSysUtil::RestartReason::get());
+  webUI.addJson(jsonDoc, "p09_restart_reason", metrics.restartReason);
 
   // Date
   webUI.addJson(jsonDoc, "p09_act_date", EspStrUtil::getDateString());
 
-  webUI.wsUpdateWebJSON(jsonDoc);
+  wsBroadcastJSON(jsonDoc);
 }
 
 /**
@@ -178,39 +237,111 @@ void updateSystemInfoElementsStatic() {
  * *******************************************************************/
 void updateExampleValues() {
 
-  webUI.initJsonBuffer(jsonDoc);
+  webElementsBegin(jsonDoc);
 
-  // Update OPMODE on Dashboard
-  if (example.opmode == 0) {
-    webUI.addJson(jsonDoc, "p01_opmode", "MANUAL");
-    webUI.addJson(jsonDoc, "p01_opmode_icon", "i_manual");
-  } else {
-    webUI.addJson(jsonDoc, "p01_opmode", "AUTOMATIC");
-    webUI.addJson(jsonDoc, "p01_opmode_icon", "i_auto");
-  }
+  if (webPageVisible(PAGE_DASHBOARD)) {
+    // Update OPMODE on Dashboard
+    if (example.opmode == 0) {
+      webElementAdd(jsonDoc, "p01_opmode", "MANUAL");
+      webElementAdd(jsonDoc, "p01_opmode_icon", "i_manual");
+    } else {
+      webElementAdd(jsonDoc, "p01_opmode", "AUTOMATIC");
+      webElementAdd(jsonDoc, "p01_opmode_icon", "i_auto");
+    }
+
+    // Update Temperature values on Dashboard
+    webElementAdd(jsonDoc, "p01_temp1", example.setTemp);
 
-  // Update Temperature values on Dashboard
-  webUI.addJson(jsonDoc, "p01_temp1", example.setTemp);
+    // Update Act/Set Temperature values on Dashboard
+    webElementAdd(jsonDoc, "p01_temp_set", example.setTemp);
+    webElementAdd(jsonDoc, "p01_temp_act", example.actTemp + 10);
+  }
 
-  // Update Act/Set Temperature values on Dashboard
-  webUI.addJson(jsonDoc, "p01_temp_set", example.setTemp);
-  webUI.addJson(jsonDoc, "p01_temp_act", example.actTemp + 10);
+  if (!webPageVisible(PAGE_TABLE)) {
+    webElementsSend(jsonDoc);
+    return;
+  }
 
   // Update Table1 values
-  webUI.addJson(jsonDoc, "p03_tab1_val1", example.tabval[0]);
-  webUI.addJson(jsonDoc, "p03_tab1_val2", example.tabval[1]);
-  webUI.addJson(jsonDoc, "p03_tab1_val3", example.tabval[2]);
-  webUI.addJson(jsonDoc, "p03_tab1_val4", example.tabval[3]);
-  webUI.addJson(jsonDoc, "p03_tab1_val5", example.tabval[4]);
+  webElementAdd(jsonDoc, "p03_tab1_val1", example.tabval[0]);
+  webElementAdd(jsonDoc, "p03_tab1_val2", example.tabval[1]);
+  webElementAdd(jsonDoc, "p03_tab1_val3", example.tabval[2]);
+  webElementAdd(jsonDoc, "p03_tab1_val4", example.tabval[3]);
+  webElementAdd(jsonDoc, "p03_tab1_val5", example.tabval[4]);
 
   // Update Table2 values
-  webUI.addJson(jsonDoc, "p03_tab2_val1", example.tabval[0] + 10);
-  webUI.addJson(jsonDoc, "p03_tab2_val2", example.tabval[1] + 10);
-  webUI.addJson(jsonDoc, "p03_tab2_val3", example.tabval[2] + 10);
-  webUI.addJson(jsonDoc, "p03_tab2_val4", example.tabval[3] + 10);
-  webUI.addJson(jsonDoc, "p03_tab2_val5", example.tabval[4] + 10);
+  webElementAdd(jsonDoc, "p03_tab2_val1", example.tabval[0] + 10);
+  webElementAdd(jsonDoc, "p03_tab2_val2", example.tabval[1] + 10);
+  webElementAdd(jsonDoc, "p03_tab2_val3", example.tabval[2] + 10);
+  webElementAdd(jsonDoc, "p03_tab2_val4", example.tabval[3] + 10);
+  webElementAdd(jsonDoc, "p03_tab2_val5", example.tabval[4] + 10);
+
+  webElementsSend(jsonDoc);
+}
+
+/**
+ * *******************************************************************
+ * @brief   add run time statistics of one task to the element update
+ * @param   row row in the performance table
+ * @param   hist run time histogram
+ * @return  none
+ * *******************************************************************/
+static void addPerfElements(int row, const s_schedhist &hist) {
+  static const char *bars[] = {"\u2581", "\u2582", "\u2583", "\u2584", "\u2585", "\u2586", "\u2587", "\u2588"};
+  static const char *columns[PERF_COLUMNS] = {"n", "min", "p50", "p99", "max", "hist"};
+  static char ids[PERF_ROWS][PERF_COLUMNS][24]; // element ids must be static strings
+
+  if (ids[row][0][0] == '\0') {
+    for (int col = 0; col < PERF_COLUMNS; col++) {
+      snprintf(ids[row][col], sizeof(ids[row][col]), "p13_%s_%s", perfRows[row], columns[col]);
+    }
+  }
+
+  webElementAdd(jsonDoc, ids[row][0], (long)hist.count);
+  webElementAdd(jsonDoc, ids[row][1], (long)hist.minUs);
+  webElementAdd(jsonDoc, ids[row][2], (long)schedPercentile(hist, 50));
+  webElementAdd(jsonDoc, ids[row][3], (long)schedPercentile(hist, 99));
+  webElementAdd(jsonDoc, ids[row][4], (long)hist.maxUs);
+
+  // histogram as bar chart with logarithmic height (one character per bucket)
+  int maxBits = 0;
+  for (int i = 0; i < SCHED_HIST_BUCKETS; i++) {
+    int bits = hist.bucket[i] ? 32 - __builtin_clz(hist.bucket[i]) : 0;
+    maxBits = bits > maxBits ? bits : maxBits;
+  }
+  char chart[SCHED_HIST_BUCKETS * 3 + 1] = {'\0'};
+  for (int i = 0; i < SCHED_HIST_BUCKETS; i++) {
+    if (hist.bucket[i] == 0) {
+      strcat(chart, " ");
+    } else {
+      int bits = 32 - __builtin_clz(hist.bucket[i]);
+      strcat(chart, bars[(bits * 8 - 1) / maxBits]);
+    }
+  }
+  webElementAdd(jsonDoc, ids[row][5], chart);
+}
 
-  webUI.wsUpdateWebJSON(jsonDoc);
+/**
+ * *******************************************************************
+ * @brief   update performance page
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+void updatePerfElements() {
+
+  if (!webPageVisible(PAGE_PERF)) {
+    return;
+  }
+
+  webElementsBegin(jsonDoc);
+  addPerfElements(0, *schedLoopHist()); // row 0: whole loop iteration
+  for (int row = 1; row < PERF_ROWS; row++) {
+    const s_schedtask *t = schedFindTask(perfRows[row]);
+    if (t != NULL) {
+      addPerfElements(row, t->hist);
+    }
+  }
+  webElementsSend(jsonDoc);
 }
 
 /**
@@ -227,11 +358,19 @@ bool webLogRefreshActive() { return logReadActive; }
  * @param   none
  * @return  none
  * *******************************************************************/
-void webReadLogBuffer() {
-  logReadActive = true;
-  logLine = 0;
-  logIdx = 0;
-}
+void webReadLogBuffer() { logReadActive = true; }
+
+/**
+ * *******************************************************************
+ * @brief   set filter for webUI logger
+ * @param   tags comma separated list of tags ("" or "*" = all)
+ * @param   level show only entries with this or a higher severity
+ * @param   minutes show only entries of the last x minutes (0 = all)
+ * @return  none
+ * *******************************************************************/
+void webLogFilterTags(const char *tags) { logFilter.tags = logTagMask(tags); }
+void webLogFilterLevel(const char *level) { logFilter.level = logLevelFromString(level); }
+void webLogFilterTime(int minutes) { logFilterMinutes = minutes; }
 
 /**
  * *******************************************************************
@@ -241,52 +380,26 @@ void webReadLogBuffer() {
  * *******************************************************************/
 void webReadLogBufferCyclic() {
 
+  static uint32_t logSeq[MAX_LOG_LINES];
+
+  s_logfilter filter = logFilter;
+  if (logFilterMinutes > 0) {
+    filter.from = time(NULL) - logFilterMinutes * 60;
+  }
+  int count = logQuery(filter, logSeq, MAX_LOG_LINES);
+
   jsonLog.clear();
   jsonLog["type"] = "logger";
   jsonLog["cmd"] = "add_log";
   JsonArray entryArray = jsonLog["entry"].to<JsonArray>();
 
-  while (logReadActive) {
-
-    if (logLine == 0 && logData.lastLine == 0) {
-      // log empty
-      logReadActive = false;
-      return;
-    }
-    if (config.log.order == 1) {
-      logIdx = (logData.lastLine - logLine - 1) % MAX_LOG_LINES;
-    } else {
-      if (logData.buffer[logData.lastLine][0] == '\0') {
-        // buffer is not full - start reading at element index 0
-        logIdx = logLine % MAX_LOG_LINES;
-      } else {
-        // buffer is full - start reading at element index "logData.lastLine"
-        logIdx = (logData.lastLine + logLine) % MAX_LOG_LINES;
-      }
-    }
-    if (logIdx < 0) {
-      logIdx += MAX_LOG_LINES;
-    }
-    if (logIdx >= MAX_LOG_LINES) {
-      logIdx = 0;
-    }
-    if (logLine == MAX_LOG_LINES - 1) {
-      // end
-      webUI.wsUpdateWebJSON(jsonLog);
-      logReadActive = false;
-      return;
-    } else {
-      if (logData.buffer[logIdx][0] != '\0') {
-        entryArray.add(logData.buffer[logIdx]);
-        logLine++;
-      } else {
-        // no more entries
-        logReadActive = false;
-        webUI.wsUpdateWebJSON(jsonLog);
-        return;
-      }
-    }
+  for (int i = 0; i < count; i++) {
+    int idx = (config.log.order == 1) ? (count - 1 - i) : i;
+    entryArray.add(logEntryText(logSeq[idx]));
   }
+
+  wsBroadcastJSON(jsonLog);
+  logReadActive = false;
 }
 
 /**
@@ -304,9 +417,35 @@ void otaProgressCallback(int progress) {
   }
 }
 
+/**
+ * *******************************************************************
+ * @brief   show the latest GitHub release
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+static void showGitHubVersion() {
+  if (ghGetLatestRelease(&ghReleaseInfo)) {
+    webUI.wsUpdateWebBusy("p00_dialog_git_version", false);
+    webUI.wsUpdateWebText("p00_dialog_git_version", ghReleaseInfo.tag, false);
+    webUI.wsUpdateWebHref("p00_dialog_git_version", ghReleaseInfo.url);
+    // if new version is available, show update button
+    if (strcmp(ghReleaseInfo.tag, VERSION) != 0) {
+      char buttonTxt[32];
+      snprintf(buttonTxt, sizeof(buttonTxt), "Update %s", ghReleaseInfo.tag);
+      webUI.wsUpdateWebText("p00_update_btn", buttonTxt, false);
+      webUI.wsUpdateWebHideElement("p00_update_btn_hide", false);
+    }
+  } else {
+    webUI.wsUpdateWebBusy("p00_dialog_git_version", false);
+    webUI.wsUpdateWebText("p00_dialog_git_version", "error", false);
+  }
+}
+
 /**
  * *******************************************************************
  * @brief   initiate GitHub version check
+ * @details the check runs in the background - a cached release is
+ *          shown at once, a fresh result when the check has finished
  * @param   none
  * @return  none
  * *******************************************************************/
@@ -315,22 +454,13 @@ void requestGitHubVersion() { startCheckGitHubVersion = true; }
 void processGitHubVersion() {
   if (startCheckGitHubVersion) {
     startCheckGitHubVersion = false;
-    if (ghGetLatestRelease(&ghLatestRelease, &ghReleaseInfo)) {
-      webUI.wsUpdateWebBusy("p00_dialog_git_version", false);
-      webUI.wsUpdateWebText("p00_dialog_git_version", ghReleaseInfo.tag, false);
-      webUI.wsUpdateWebHref("p00_dialog_git_version", ghReleaseInfo.url);
-      // if new version is available, show update button
-      if (strcmp(ghReleaseInfo.tag, VERSION) != 0) {
-        char buttonTxt[32];
-        snprintf(buttonTxt, sizeof(buttonTxt), "Update %s", ghReleaseInfo.tag);
-        webUI.wsUpdateWebText("p00_update_btn", buttonTxt, false);
-        webUI.wsUpdateWebHideElement("p00_update_btn_hide", false);
-      }
-    } else {
-      webUI.wsUpdateWebBusy("p00_dialog_git_version", false);
-      webUI.wsUpdateWebText("p00_dialog_git_version", "error", false);
+    if (ghRequestLatestRelease()) {
+      showGitHubVersion();
     }
   }
+  if (ghReleaseCheckDone()) {
+    showGitHubVersion();
+  }
 }
 
 /**
@@ -349,7 +479,7 @@ void processGitHubUpdate() {
     webUI.wsUpdateWebDisabled("p00_update_btn", true);
     ota.setActive(true);
     wdt.disable();
-    int result = ghStartOtaUpdate(ghLatestRelease, ghReleaseInfo.asset);
+    int result = ghStartOtaUpdate(ghReleaseInfo);
     if (result == OTA_SUCCESS) {
       webUI.wsUpdateWebText("p00_update_btn", "updating: 100%", false);
       webUI.wsUpdateWebDialog("version_dialog", "close");
@@ -412,9 +542,18 @@ void webUIupdates() {
     refreshRequest = false;
   }
 
+  // PAGE-CHANGE: refresh elements of a page that has become visible
+  if (pageRefresh && !refreshRequest && !ota.isActive()) {
+    updateSystemInfoElements();
+    updateExampleValues();
+    updatePerfElements();
+    pageRefresh = false;
+  }
+
   // CYCLIC: update SINGLE elemets every x seconds - do this step by step not to stress the connection
   if (refreshTimer2.cycleTrigger(WEBUI_SLOW_REFRESH_TIME_MS) && !refreshRequest && !ota.isActive()) {
     updateSystemInfoElements(); // refresh all "System" elements as one big JSON update (≈ 570 Bytes)
     updateExampleValues();      // refresh all "Example" elements
+    updatePerfElements();       // refresh loop performance (only if the page is visible)
   }
 }
@@ -0,0 +1,449 @@
+#include <basics.h>
+#include <jsonArena.h>
+#include <memory>
+#include <vector>
+#include <webUI.h>
+#include <webUIelements.h>
+#include <wsBroadcast.h>
+
+/* D E C L A R A T I O N S ****************************************************/
+static const char *TAG = "WEB"; // LOG TAG
+s_wsbroadcast wsBroadcastStat;
+
+// backpressure state of one client (id 0 = unused slot)
+struct s_wsclient {
+  uint32_t id;                                                        // id of the AsyncWebSocket client
+  JsonDocument pending;                                               // merged updates: {"c":client,"n":{idx:id},"e":{idx:value},"j":{id:value}}
+  AsyncWebSocketSharedBuffer log;                                     // latest logger frame
+  std::weak_ptr<std::vector<uint8_t>> queued[WS_CLIENT_QUEUE_BUDGET]; // frames in the queue of the client (expired = sent)
+};
+
+static s_wsclient wsClients[WS_CLIENTS_MAX];
+static uint32_t wsNextId = 1;                 // clients with a lower id are tracked or gone (ids are never reused)
+static uint32_t wsScanEnd = 1;                // ids below are checked while a connected client is not tracked yet
+static JsonArena flushArena("wsflush", 2048); // JSON memory for merged frames
+
+// every client needs a slot - clients are only reached by their id
+static_assert(WS_CLIENTS_MAX >= DEFAULT_MAX_WS_CLIENTS, "WS_CLIENTS_MAX is smaller than the client limit of AsyncWebSocket");
+static_assert(WS_CLIENT_QUEUE_BUDGET < WS_MAX_QUEUED_MESSAGES, "WS_CLIENT_QUEUE_BUDGET must be below the queue limit of AsyncWebSocket");
+
+/**
+ * *******************************************************************
+ * @brief   serialize JSON message into a reference counted buffer
+ * @details element updates are written as binary frame (serializeElements)
+ * @param   doc JSON message
+ * @return  buffer
+ * *******************************************************************/
+static AsyncWebSocketSharedBuffer wsSerialize(JsonDocument &doc) {
+  size_t len = measureElements(doc);
+  if (len > 0) {
+    AsyncWebSocketSharedBuffer buffer = std::make_shared<std::vector<uint8_t>>(len);
+    serializeElements(doc, buffer->data(), len);
+    return buffer;
+  }
+  len = measureJson(doc);
+  AsyncWebSocketSharedBuffer buffer = std::make_shared<std::vector<uint8_t>>(len);
+  serializeJson(doc, (char *)buffer->data(), len);
+  return buffer;
+}
+
+/**
+ * *******************************************************************
+ * @brief   queue serialized message on a client as text or binary frame
+ * @param   ws WebSocket
+ * @param   id id of the AsyncWebSocket client
+ * @param   buffer serialized message
+ * @return  false if the message could not be queued
+ * *******************************************************************/
+static bool wsWrite(AsyncWebSocket &ws, uint32_t id, const AsyncWebSocketSharedBuffer &buffer) {
+  if (!buffer->empty() && (*buffer)[0] == WEB_ELEMENTS_FRAME) {
+    return ws.binary(id, buffer);
+  }
+  return ws.text(id, buffer);
+}
+
+/**
+ * *******************************************************************
+ * @brief   update the table of connected clients
+ * @details the client list of AsyncWebSocket is changed by the AsyncTCP
+ *          task, so it is never walked here, and its connect/disconnect
+ *          events go to the handler of EspWebUI. Clients are only accessed
+ *          by their id through the AsyncWebSocket functions that look up
+ *          the client themselves:
+ *          - disconnect: the id is no longer known (ws.hasClient)
+ *          - connect: ws.count() is higher than the number of tracked
+ *            clients. AsyncWebSocket numbers its clients 1, 2, 3, ... so
+ *            the new client has an id of wsNextId or above. The ids are
+ *            checked from wsNextId on (WS_CLIENT_SCAN more per cycle) until
+ *            the client is found. wsNextId only moves behind a found id -
+ *            lower ids have been assigned before and are gone, an id that
+ *            is not assigned yet is never skipped.
+ * @param   ws WebSocket
+ * @param   count number of connected clients
+ * @return  none
+ * *******************************************************************/
+static void wsClientsUpdate(AsyncWebSocket &ws, size_t count) {
+
+  // release the state of disconnected clients
+  size_t known = 0;
+  for (int i = 0; i < WS_CLIENTS_MAX; i++) {
+    s_wsclient &c = wsClients[i];
+    if (c.id != 0 && !ws.hasClient(c.id)) {
+      ESP_LOGD(TAG, "WebSocket client %" PRIu32 " disconnected", c.id);
+      c.pending.clear();
+      c.log.reset();
+      for (std::weak_ptr<std::vector<uint8_t>> &queued : c.queued) {
+        queued.reset();
+      }
+      c.id = 0;
+    }
+    if (c.id != 0) {
+      known++;
+    }
+  }
+  if (known >= count) {
+    wsScanEnd = wsNextId;
+    return;
+  }
+
+  // connected client that is not tracked yet
+  wsScanEnd += WS_CLIENT_SCAN;
+  for (uint32_t id = wsNextId; known < count && id < wsScanEnd; id++) {
+    if (!ws.hasClient(id)) {
+      continue;
+    }
+    int slot = 0;
+    while (slot < WS_CLIENTS_MAX && wsClients[slot].id != 0) {
+      slot++;
+    }
+    if (slot == WS_CLIENTS_MAX) {
+      return; // AsyncWebSocket closes clients above its limit - a slot is released before the client is taken
+    }
+    wsClients[slot].id = id;
+    known++;
+    wsNextId = id + 1;
+    ESP_LOGD(TAG, "WebSocket client %" PRIu32 " connected", id);
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   queue frame on a client within its budget
+ * @details every client gets its own handle of the shared frame: the data
+ *          is shared, but the handle has its own reference count. The
+ *          handle is released by AsyncWebSocket when the frame has been
+ *          sent (or the client is gone) - an expired handle is a free
+ *          place in the budget of WS_CLIENT_QUEUE_BUDGET frames.
+ * @param   ws WebSocket
+ * @param   c client state
+ * @param   buffer serialized message
+ * @return  false if the budget of the client is used up
+ * *******************************************************************/
+static bool wsClientQueue(AsyncWebSocket &ws, s_wsclient &c, const AsyncWebSocketSharedBuffer &buffer) {
+  for (std::weak_ptr<std::vector<uint8_t>> &queued : c.queued) {
+    if (queued.expired()) {
+      AsyncWebSocketSharedBuffer handle(buffer.get(), [buffer](std::vector<uint8_t> *) {});
+      queued = handle;
+      wsWrite(ws, c.id, handle);
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * *******************************************************************
+ * @brief   check if a client can take another frame
+ * @param   ws WebSocket
+ * @param   c client state
+ * @return  true if the client is within its budget (and the queue of AsyncWebSocket is not full)
+ * *******************************************************************/
+static bool wsClientReady(AsyncWebSocket &ws, const s_wsclient &c) {
+  for (const std::weak_ptr<std::vector<uint8_t>> &queued : c.queued) {
+    if (queued.expired()) {
+      return ws.availableForWrite(c.id);
+    }
+  }
+  return false;
+}
+
+/**
+ * *******************************************************************
+ * @brief   check if a client has merged updates that are not sent yet
+ * @param   c client state
+ * @return  true if updates are pending
+ * *******************************************************************/
+static bool wsClientPending(const s_wsclient &c) { return !c.pending.isNull() || c.log; }
+
+/**
+ * *******************************************************************
+ * @brief   set pending value - the latest value wins
+ * @param   pending merged updates of the client
+ * @param   group "n" (announcements), "e" (element values) or "j" (values by id)
+ * @param   key element index or id
+ * @param   value new value
+ * @return  none
+ * *******************************************************************/
+static void wsClientSet(JsonDocument &pending, const char *group, const char *key, JsonVariantConst value) {
+  char *copy = (char *)key; // non-const key: ArduinoJson stores a copy
+  if (strcmp(group, "n") && !pending[group][copy].isNull()) {
+    wsBroadcastStat.coalesced++;
+  }
+  pending[group][copy] = value;
+}
+
+/**
+ * *******************************************************************
+ * @brief   merge frame into the pending updates of a slow client
+ * @param   c client state
+ * @param   doc JSON message
+ * @param   buffer serialized message
+ * @return  false if the message type can not be merged
+ * *******************************************************************/
+static bool wsClientMerge(s_wsclient &c, JsonDocument &doc, AsyncWebSocketSharedBuffer buffer) {
+  char key[8];
+  const char *type = doc["type"] | "";
+
+  if (!strcmp(type, "elements")) {
+    if (!doc["c"].isNull()) {
+      c.pending["c"] = doc["c"];
+    }
+    JsonArrayConst d = doc["d"];
+    for (size_t i = 0; i + 1 < d.size(); i += 2) {
+      snprintf(key, sizeof(key), "%d", d[i].as<int>());
+      wsClientSet(c.pending, "n", key, d[i + 1]);
+    }
+    JsonArrayConst v = doc["v"];
+    for (size_t i = 0; i + 1 < v.size(); i += 2) {
+      snprintf(key, sizeof(key), "%d", v[i].as<int>());
+      wsClientSet(c.pending, "e", key, v[i + 1]);
+    }
+    for (JsonPairConst p : doc["j"].as<JsonObjectConst>()) {
+      wsClientSet(c.pending, "j", p.key().c_str(), p.value());
+    }
+  } else if (!strcmp(type, "updateJSON")) {
+    for (JsonPairConst p : doc.as<JsonObjectConst>()) {
+      if (strcmp(p.key().c_str(), "type")) {
+        wsClientSet(c.pending, "j", p.key().c_str(), p.value());
+      }
+    }
+  } else if (!strcmp(type, "logger")) {
+    // the logger frame always contains the whole log view
+    if (c.log) {
+      wsBroadcastStat.coalesced++;
+    }
+    c.log = buffer;
+  } else {
+    return false;
+  }
+  wsBroadcastStat.merged++;
+  return true;
+}
+
+/**
+ * *******************************************************************
+ * @brief   send merged updates as one frame
+ * @param   ws WebSocket
+ * @param   c client state
+ * @return  none
+ * *******************************************************************/
+static void wsClientFlush(AsyncWebSocket &ws, s_wsclient &c) {
+
+  if (!c.pending.isNull()) {
+    JsonDocument frame(&flushArena);
+    frame["type"] = "elements";
+    if (!c.pending["c"].isNull()) {
+      frame["c"] = c.pending["c"];
+    }
+    for (JsonPairConst p : c.pending["n"].as<JsonObjectConst>()) {
+      frame["d"].add(atoi(p.key().c_str()));
+      frame["d"].add(p.value());
+    }
+    for (JsonPairConst p : c.pending["e"].as<JsonObjectConst>()) {
+      frame["v"].add(atoi(p.key().c_str()));
+      frame["v"].add(p.value());
+    }
+    if (c.pending["j"].is<JsonObjectConst>()) {
+      frame["j"] = c.pending["j"];
+    }
+    if (!wsClientQueue(ws, c, wsSerialize(frame))) {
+      return; // budget used up - try again in the next cycle
+    }
+    c.pending.clear();
+    wsBroadcastStat.flushed++;
+  }
+  if (c.log && wsClientQueue(ws, c, c.log)) {
+    c.log.reset();
+    wsBroadcastStat.flushed++;
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   send message to a client or merge it if the client is slow
+ * @param   ws WebSocket
+ * @param   c client state
+ * @param   doc JSON message
+ * @param   buffer serialized message
+ * @return  none
+ * *******************************************************************/
+static void wsClientSend(AsyncWebSocket &ws, s_wsclient &c, JsonDocument &doc, const AsyncWebSocketSharedBuffer &buffer) {
+  if (!wsClientPending(c) && ws.availableForWrite(c.id) && wsClientQueue(ws, c, buffer)) {
+    return;
+  }
+  if (!wsClientMerge(c, doc, buffer)) {
+    wsWrite(ws, c.id, buffer); // message type that can not be merged
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   send JSON message to all connected WebSocket clients
+ * @details the message is serialized once into a reference counted buffer
+ *          and the same buffer is queued on every client. A client with
+ *          WS_CLIENT_QUEUE_BUDGET frames in its queue (or a full queue of
+ *          AsyncWebSocket) gets nothing queued - its updates are merged
+ *          (latest value wins) and sent as one frame when it has caught up
+ *          (see wsBroadcastCyclic).
+ *          The single element helpers of EspWebUI (wsUpdateWebText etc.)
+ *          still build their own frame on every call.
+ * @param   doc JSON message
+ * @return  none
+ * *******************************************************************/
+void wsBroadcastJSON(JsonDocument &doc) {
+
+  AsyncWebSocket &ws = webUI.getWebSocket();
+  size_t clients = ws.count();
+  if (clients == 0) {
+    return;
+  }
+
+  uint32_t start = micros();
+  AsyncWebSocketSharedBuffer buffer = wsSerialize(doc);
+  wsClientsUpdate(ws, clients);
+  for (int i = 0; i < WS_CLIENTS_MAX; i++) {
+    s_wsclient &c = wsClients[i];
+    if (c.id != 0) {
+      wsClientSend(ws, c, doc, buffer);
+    }
+  }
+
+  uint32_t duration = micros() - start;
+  wsBroadcastStat.frames++;
+  wsBroadcastStat.bytes += buffer->size();
+  wsBroadcastStat.clients = clients;
+  wsBroadcastStat.lastUs = duration;
+  if (duration > wsBroadcastStat.maxUs) {
+    wsBroadcastStat.maxUs = duration;
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   send JSON message to one WebSocket client
+ * @details a slow client gets the message merged like a broadcast
+ * @param   id id of the AsyncWebSocket client
+ * @param   doc JSON message
+ * @return  none
+ * *******************************************************************/
+void wsSendJSON(uint32_t id, JsonDocument &doc) {
+
+  AsyncWebSocket &ws = webUI.getWebSocket();
+  for (int i = 0; i < WS_CLIENTS_MAX; i++) {
+    s_wsclient &c = wsClients[i];
+    if (c.id != id) {
+      continue;
+    }
+    wsClientSend(ws, c, doc, wsSerialize(doc));
+    return;
+  }
+}
+
+/**
+ * *******************************************************************
+ * @brief   get ids of the connected WebSocket clients
+ * @param   ids output array
+ * @param   max size of the output array
+ * @return  number of clients
+ * *******************************************************************/
+int wsClientIds(uint32_t *ids, int max) {
+
+  AsyncWebSocket &ws = webUI.getWebSocket();
+  wsClientsUpdate(ws, ws.count());
+  int count = 0;
+  for (int i = 0; i < WS_CLIENTS_MAX && count < max; i++) {
+    if (wsClients[i].id != 0) {
+      ids[count++] = wsClients[i].id;
+    }
+  }
+  return count;
+}
+
+/**
+ * *******************************************************************
+ * @brief   send merged updates to clients that have caught up and
+ *          release the state of disconnected clients
+ * @param   none
+ * @return  none
+ * *******************************************************************/
+void wsBroadcastCyclic() {
+
+  AsyncWebSocket &ws = webUI.getWebSocket();
+  uint32_t slow = 0;
+
+  wsClientsUpdate(ws, ws.count());
+  for (int i = 0; i < WS_CLIENTS_MAX; i++) {
+    s_wsclient &c = wsClients[i];
+    if (c.id == 0 || !wsClientPending(c)) {
+      continue;
+    }
+    if (wsClientReady(ws, c)) {
+      wsClientFlush(ws, c);
+    }
+    if (wsClientPending(c)) {
+      slow++;
+    }
+  }
+  wsBroadcastStat.slowClients = slow;
+}
+
+/**
+ * *******************************************************************
+ * @brief   compare serialize per client with serialize once
+ * @details no real clients needed - the client queues are simulated
+ *          with the same buffer types as AsyncWebSocket uses
+ * @param   doc JSON message
+ * @param   clients number of simulated clients (1..WS_BENCH_CLIENTS_MAX)
+ * @param   result measured time and heap usage
+ * @return  none
+ * *******************************************************************/
+void wsBroadcastBenchmark(JsonDocument &doc, int clients, s_wsbench *result) {
+
+  AsyncWebSocketSharedBuffer queue[WS_BENCH_CLIENTS_MAX];
+  clients = constrain(clients, 1, WS_BENCH_CLIENTS_MAX);
+  size_t len = measureJson(doc);
+
+  // before: every client serializes the message into its own buffer
+  uint32_t heap = ESP.getFreeHeap();
+  uint32_t start = micros();
+  for (int i = 0; i < clients; i++) {
+    queue[i] = std::make_shared<std::vector<uint8_t>>(measureJson(doc));
+    serializeJson(doc, (char *)queue[i]->data(), queue[i]->size());
+  }
+  result->perClientUs = micros() - start;
+  result->perClientHeap = heap - ESP.getFreeHeap();
+  for (int i = 0; i < clients; i++) {
+    queue[i].reset();
+  }
+
+  // after: serialize once and share the buffer
+  heap = ESP.getFreeHeap();
+  start = micros();
+  AsyncWebSocketSharedBuffer shared = std::make_shared<std::vector<uint8_t>>(len);
+  serializeJson(doc, (char *)shared->data(), len);
+  for (int i = 0; i < clients; i++) {
+    queue[i] = shared;
+  }
+  result->onceUs = micros() - start;
+  result->onceHeap = heap - ESP.getFreeHeap();
+}
@@ -0,0 +1,94 @@
+// Host test of the OTA stream (src/otaDelta.cpp, src/otaInflate.cpp)
+//
+// usage: ota_delta_test <dir>
+// <dir> contains old.bin (running firmware), new.bin and the files that
+// scripts/delta_ota.py and scripts/compress_ota.py create from them:
+// patch.bin (delta), new.z (compressed image), patch.z (compressed delta).
+// Every stream has to result in new.bin in the update partition.
+#include <otaDelta.h>
+#include <otaWriter.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+std::vector<uint8_t> hostImage;   // update partition (test/host/stub/esp_ota_ops.h)
+std::vector<uint8_t> hostRunning; // running partition (test/host/stub/esp_partition.h)
+
+static int failed = 0;
+
+static std::vector<uint8_t> readFile(const std::string &path) {
+  std::vector<uint8_t> data;
+  FILE *f = fopen(path.c_str(), "rb");
+  if (f == NULL) {
+    printf("FAIL %s not found\n", path.c_str());
+    failed++;
+    return data;
+  }
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+    data.insert(data.end(), buf, buf + n);
+  }
+  fclose(f);
+  return data;
+}
+
+// pass stream in changing chunk sizes, starting with chunk (1 = header byte by byte)
+static bool streamChunks(const std::vector<uint8_t> &stream, size_t chunk) {
+  otaStreamBegin(stream.size());
+  size_t pos = 0;
+  while (pos < stream.size()) {
+    size_t n = chunk < stream.size() - pos ? chunk : stream.size() - pos;
+    if (!otaStreamWrite(stream.data() + pos, n)) {
+      otaStreamAbort();
+      return false;
+    }
+    pos += n;
+    chunk = (chunk * 13 + 7) % 1500 + 1;
+  }
+  return otaStreamEnd();
+}
+
+static void check(const char *name, bool ok) {
+  printf("%s %s%s%s\n", ok ? "ok  " : "FAIL", name, otaStat.error ? " - " : "", otaStat.error ? otaStat.error : "");
+  failed += ok ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    printf("usage: ota_delta_test <dir>\n");
+    return 1;
+  }
+  std::string dir = argv[1];
+  hostRunning = readFile(dir + "/old.bin");
+  std::vector<uint8_t> newImage = readFile(dir + "/new.bin");
+
+  struct {
+    const char *file;
+    bool compressed;
+    bool delta;
+  } streams[] = {{"new.bin", false, false}, {"new.z", true, false}, {"patch.bin", false, true}, {"patch.z", true, true}};
+  for (const auto &s : streams) {
+    std::vector<uint8_t> stream = readFile(dir + "/" + s.file);
+    for (size_t chunk : {1, 1436}) {
+      bool ok = streamChunks(stream, chunk) && hostImage == newImage && otaDeltaStat.compressed == s.compressed && otaDeltaStat.delta == s.delta;
+      std::string name = std::string(s.file) + (chunk == 1 ? " (small chunks)" : " (segments)");
+      check(name.c_str(), ok);
+    }
+  }
+
+  std::vector<uint8_t> patch = readFile(dir + "/patch.z");
+  std::vector<uint8_t> bad = patch;
+  bad.resize(bad.size() - 20);
+  check("truncated stream rejected", !streamChunks(bad, 700));
+
+  bad = patch;
+  bad[bad.size() / 2] ^= 0x55;
+  check("corrupt stream rejected", !streamChunks(bad, 700));
+
+  hostRunning[hostRunning.size() / 3] ^= 1; // patch does not belong to the running firmware
+  check("other running firmware rejected", !streamChunks(patch, 1436));
+
+  printf("%s\n", failed ? "FAILED" : "all tests passed");
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,83 @@
+// Host test of the pipelined OTA writer (src/otaWriter.cpp)
+//
+// The writer task runs as std::thread (test/host/stub), the update
+// partition is a vector that is compared with the written image.
+// The benchmark uses the simulated flash and network of the writer.
+#include <openssl/sha.h>
+#include <otaWriter.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+std::vector<uint8_t> hostImage; // update partition (test/host/stub/esp_ota_ops.h)
+
+static int failed = 0;
+
+static void check(const char *name, bool ok) {
+  printf("%s %s%s%s\n", ok ? "ok  " : "FAIL", name, otaStat.error ? " - " : "", otaStat.error ? otaStat.error : "");
+  failed += ok ? 0 : 1;
+}
+
+// write image in changing chunk sizes (1 .. 3000 bytes, like TCP segments of different size)
+static void writeChunks(const uint8_t *data, size_t size) {
+  size_t pos = 0;
+  size_t chunk = 1;
+  while (pos < size) {
+    size_t n = chunk < size - pos ? chunk : size - pos;
+    otaWriterWrite(data + pos, n);
+    pos += n;
+    chunk = (chunk * 13 + 7) % 3000 + 1;
+  }
+}
+
+int main(int argc, char **argv) {
+  static uint8_t image[300001]; // not a multiple of the buffer size
+  for (size_t i = 0; i < sizeof(image); i++) {
+    image[i] = (uint8_t)((i * 7919) >> 3);
+  }
+  uint8_t sha[32];
+  SHA256(image, sizeof(image), sha);
+
+  for (int pipelined = 0; pipelined < 2; pipelined++) {
+    otaWriterBegin(sizeof(image), NULL, pipelined);
+    writeChunks(image, sizeof(image));
+    bool ok = otaWriterEnd(sha) && hostImage.size() == sizeof(image) && memcmp(hostImage.data(), image, sizeof(image)) == 0;
+    check(pipelined ? "pipelined image" : "serial image", ok);
+  }
+
+  otaWriterBegin(0); // unknown size
+  otaWriterWrite(image, sizeof(image));
+  check("unknown size", otaWriterEnd(sha) && hostImage.size() == sizeof(image));
+
+  otaWriterBegin(sizeof(image));
+  otaWriterWrite(image, sizeof(image) - 1);
+  check("size mismatch rejected", !otaWriterEnd(sha) && strcmp(otaStat.error, "size mismatch") == 0);
+
+  sha[0] ^= 1;
+  otaWriterBegin(0);
+  otaWriterWrite(image, sizeof(image));
+  check("sha mismatch rejected", !otaWriterEnd(sha) && strcmp(otaStat.error, "SHA-256 mismatch") == 0);
+
+  otaWriterBegin(0);
+  otaWriterWrite(image, 10000);
+  otaWriterAbort();
+  check("abort", !otaStat.active && strcmp(otaStat.error, "aborted") == 0);
+
+  // receive-then-write vs. pipelined, all round trip times with "bench"
+  printf("\nsimulated update of 128 KB (flash: %d ms erase per sector, %d us per page)\n", OTA_SIM_ERASE_MS, OTA_SIM_PAGE_US);
+  bool all = argc > 1 && strcmp(argv[1], "bench") == 0;
+  for (uint32_t rtt : {5u, 40u, 80u}) {
+    if (!all && rtt != OTA_SIM_RTT_MS) {
+      continue;
+    }
+    for (uint32_t kbps : {50u, 100u, 200u}) {
+      s_otabench result;
+      otaWriterBenchmark(128 * 1024, kbps, rtt, &result);
+      printf("rtt %2u ms, network %3u KB/s: serial %5u ms (%3u KB/s), pipelined %5u ms (%3u KB/s)\n", rtt, kbps, result.serialMs,
+             result.serialKbps, result.pipeMs, result.pipeKbps);
+    }
+  }
+
+  printf("%s\n", failed ? "FAILED" : "all tests passed");
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,74 @@
+# Host test of the release asset names (scripts/release_deltas.py)
+#
+# usage: python3 test/host/release_deltas_test.py <dir>
+# The GitHub API is replaced by a fake release list with the asset names of
+# scripts/build_release.py. The created delta names have to contain the pattern
+# the device searches for (ghDeltaAsset in src/github.cpp) and the history must
+# only contain published images.
+import io
+import json
+import os
+import re
+import sys
+
+sys.path.insert(0, "scripts")
+import delta_ota
+import release_deltas
+
+failed = 0
+
+
+def check(name, ok):
+    global failed
+    print(("ok   " if ok else "FAIL ") + name)
+    failed += 0 if ok else 1
+
+
+def device_pattern(version):
+    source = open("src/github.cpp").read()
+    fmt = re.search(r'snprintf\(pattern, sizeof\(pattern\), "([^"]*)", VERSION\)', source).group(1)
+    return fmt.replace("%s", version)
+
+
+out = sys.argv[1]
+version = re.search(r'#define VERSION\s+"(.+)"', open("include/config.h").read()).group(1)
+old = delta_ota._modified(bytes(range(256)) * 64, 1)
+images = {"v0.8.0": delta_ota._modified(old, 3), "v0.9.0": old, version: delta_ota._modified(old, 2)}
+releases = [
+    {"tag_name": tag, "draft": False, "published_at": f"2026-0{i + 1}-01T00:00:00Z",
+     "assets": [{"name": release_deltas.ota_name(tag), "browser_download_url": "https://github.com/download/" + tag}]}
+    for i, tag in enumerate(["v0.8.0", "v0.9.0", version])
+][::-1]
+
+
+def urlopen(request, timeout):
+    url = request.full_url
+    return io.BytesIO(json.dumps(releases).encode() if url.startswith("https://api.github.com/") else images[url.split("/")[-1]])
+
+
+release_deltas.urllib.request.urlopen = urlopen
+history = os.path.join(out, "release_history")
+release = os.path.join(out, "release")
+for d in (history, release):
+    os.makedirs(d, exist_ok=True)
+    for name in os.listdir(d):
+        os.remove(os.path.join(d, name))
+app = os.path.join(out, "firmware.bin")
+open(app, "wb").write(images[version])
+
+files = [os.path.basename(f) for f in release_deltas.create_deltas(app, version, release, history)]
+check("history contains the published images of the previous releases",
+      sorted(os.listdir(history)) == sorted(release_deltas.ota_name(t) for t in ("v0.8.0", "v0.9.0")))
+for tag in ("v0.8.0", "v0.9.0"):
+    names = [f for f in files if device_pattern(tag) in f]
+    check(f"delta for a device with {tag} found by \"{device_pattern(tag)}\"", len(names) == 1)
+    patch = open(os.path.join(release, names[0]), "rb").read() if names else b""
+    check(f"delta from {tag} results in the new image",
+          names != [] and delta_ota.apply_patch(images[tag], release_deltas.compress_ota.decompress(patch)) == images[version])
+check(f"no delta for the current release {version}", not any(device_pattern(version) in f for f in files))
+
+release_deltas.create_deltas(app, version, release, history)  # second release build with the same history
+check("local build not stored as delta base", release_deltas.ota_name(version) not in os.listdir(history))
+
+print("FAILED" if failed else "all tests passed")
+sys.exit(1 if failed else 0)
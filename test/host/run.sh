@@ -0,0 +1,43 @@
+#!/bin/sh
+# Build and run the host tests (no Arduino / ESP-IDF needed)
+#
+# usage: test/host/run.sh
+set -e
+cd "$(dirname "$0")/../.."
+OUT=${OUT:-${TMPDIR:-/tmp}/espwebui-host}
+CXX=${CXX:-g++}
+CXXFLAGS="-std=gnu++17 -O1 -g -Wall -fsanitize=address,undefined -Iinclude"
+BENCHFLAGS="-std=gnu++17 -O2 -Wall -Iinclude" # benchmarks without sanitizers
+mkdir -p "$OUT"
+
+echo "== syslog formatter"
+$CXX $CXXFLAGS test/host/syslog_test.cpp src/syslogFormat.cpp -o "$OUT/syslog_test"
+"$OUT/syslog_test"
+
+echo "== webCallback dispatch benchmark"
+grep -o 'WEB_ID_CASE("[^"]*")' src/webUIcallback.cpp >"$OUT/webcallback_ids.inc"
+$CXX $BENCHFLAGS -I"$OUT" test/host/webcallback_bench.cpp -o "$OUT/webcallback_bench"
+"$OUT/webcallback_bench"
+
+echo "== OTA writer"
+$CXX -Itest/host/stub $CXXFLAGS -Wno-deprecated-declarations test/host/ota_writer_test.cpp src/otaWriter.cpp -lcrypto -lpthread -o "$OUT/ota_writer_test"
+"$OUT/ota_writer_test"
+
+echo "== OTA delta and compressed stream"
+python3 -c "
+import random, sys
+sys.path.insert(0, 'scripts')
+import delta_ota
+old = bytes(random.Random(1).getrandbits(8) for _ in range(200 * 1024))
+open('$OUT/old.bin', 'wb').write(old)
+open('$OUT/new.bin', 'wb').write(delta_ota._modified(old, 2))
+"
+python3 scripts/delta_ota.py diff "$OUT/old.bin" "$OUT/new.bin" "$OUT/patch.bin"
+python3 scripts/compress_ota.py compress "$OUT/new.bin" "$OUT/new.z"
+python3 scripts/compress_ota.py compress "$OUT/patch.bin" "$OUT/patch.z"
+$CXX -Itest/host/stub $CXXFLAGS -Wno-deprecated-declarations test/host/ota_delta_test.cpp src/otaDelta.cpp src/otaInflate.cpp src/otaWriter.cpp \
+  -lcrypto -lz -lpthread -o "$OUT/ota_delta_test"
+"$OUT/ota_delta_test" "$OUT"
+
+echo "== release delta names"
+python3 test/host/release_deltas_test.py "$OUT"
@@ -0,0 +1,10 @@
+// Host stub: the parts of Arduino.h used by the modules under test
+#pragma once
+#include <algorithm>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+using std::max;
+using std::min;
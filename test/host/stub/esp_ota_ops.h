@@ -0,0 +1,37 @@
+// Host stub: the OTA partition is a vector (hostImage) that the tests compare
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+typedef int esp_err_t;
+typedef uint32_t esp_ota_handle_t;
+struct esp_partition_t {
+  uint32_t size;
+};
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define OTA_WITH_SEQUENTIAL_WRITES 0xfffffffe
+
+extern std::vector<uint8_t> hostImage; // content of the update partition
+
+inline const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *) {
+  static esp_partition_t partition = {0x1e0000};
+  return &partition;
+}
+inline const esp_partition_t *esp_ota_get_running_partition() {
+  static esp_partition_t partition = {0x1e0000};
+  return &partition;
+}
+inline esp_err_t esp_ota_begin(const esp_partition_t *, size_t, esp_ota_handle_t *) {
+  hostImage.clear();
+  return ESP_OK;
+}
+inline esp_err_t esp_ota_write(esp_ota_handle_t, const void *data, size_t len) {
+  hostImage.insert(hostImage.end(), (const uint8_t *)data, (const uint8_t *)data + len);
+  return ESP_OK;
+}
+inline esp_err_t esp_ota_end(esp_ota_handle_t) { return ESP_OK; }
+inline esp_err_t esp_ota_abort(esp_ota_handle_t) { return ESP_OK; }
+inline esp_err_t esp_ota_set_boot_partition(const esp_partition_t *) { return ESP_OK; }
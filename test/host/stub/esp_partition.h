@@ -0,0 +1,14 @@
+// Host stub: the running firmware is a vector (hostRunning), erased flash behind it
+#pragma once
+#include <esp_ota_ops.h>
+#include <string.h>
+#include <vector>
+
+extern std::vector<uint8_t> hostRunning; // content of the running partition
+
+inline esp_err_t esp_partition_read(const esp_partition_t *, size_t offset, void *dst, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    ((uint8_t *)dst)[i] = offset + i < hostRunning.size() ? hostRunning[offset + i] : 0xff;
+  }
+  return ESP_OK;
+}
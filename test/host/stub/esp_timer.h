@@ -0,0 +1,9 @@
+// Host stub: microseconds since the first call
+#pragma once
+#include <chrono>
+#include <stdint.h>
+
+inline int64_t esp_timer_get_time() {
+  static auto start = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
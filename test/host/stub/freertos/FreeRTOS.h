@@ -0,0 +1,70 @@
+// Host stub: FreeRTOS queues, semaphores and tasks on top of std::thread
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE 1
+#define pdPASS 1
+#define portMAX_DELAY 0xffffffffu
+#define pdMS_TO_TICKS(ms) (ms)
+
+struct s_hostqueue {
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<std::vector<uint8_t>> items;
+  size_t length;   // max number of items
+  size_t itemSize; // size of one item
+};
+typedef s_hostqueue *QueueHandle_t;
+typedef s_hostqueue *SemaphoreHandle_t;
+
+inline QueueHandle_t xQueueCreate(size_t length, size_t itemSize) {
+  QueueHandle_t queue = new s_hostqueue;
+  queue->length = length;
+  queue->itemSize = itemSize;
+  return queue;
+}
+// the tests never need a timeout - send and receive block until possible
+inline BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t) {
+  std::unique_lock<std::mutex> lock(queue->mutex);
+  queue->cv.wait(lock, [queue] { return queue->items.size() < queue->length; });
+  queue->items.emplace_back((const uint8_t *)item, (const uint8_t *)item + queue->itemSize);
+  queue->cv.notify_all();
+  return pdTRUE;
+}
+inline BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t) {
+  std::unique_lock<std::mutex> lock(queue->mutex);
+  queue->cv.wait(lock, [queue] { return !queue->items.empty(); });
+  memcpy(item, queue->items.front().data(), queue->itemSize);
+  queue->items.pop_front();
+  queue->cv.notify_all();
+  return pdTRUE;
+}
+inline void vQueueDelete(QueueHandle_t queue) { delete queue; }
+
+inline SemaphoreHandle_t xSemaphoreCreateBinary() { return xQueueCreate(1, 1); }
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+  uint8_t token = 0;
+  return xQueueSend(sem, &token, 0);
+}
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+  uint8_t token;
+  return xQueueReceive(sem, &token, ticks);
+}
+inline void vSemaphoreDelete(SemaphoreHandle_t sem) { delete sem; }
+
+inline void vTaskDelay(TickType_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline BaseType_t xTaskCreate(void (*task)(void *), const char *, uint32_t, void *param, int, void *) {
+  std::thread(task, param).detach();
+  return pdPASS;
+}
+inline void vTaskDelete(void *) {}
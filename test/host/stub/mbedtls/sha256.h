@@ -0,0 +1,11 @@
+// Host stub: mbedtls SHA-256 on top of OpenSSL
+#pragma once
+#include <openssl/sha.h>
+
+typedef SHA256_CTX mbedtls_sha256_context;
+
+inline void mbedtls_sha256_init(mbedtls_sha256_context *) {}
+inline int mbedtls_sha256_starts(mbedtls_sha256_context *ctx, int) { return SHA256_Init(ctx) == 1 ? 0 : -1; }
+inline int mbedtls_sha256_update(mbedtls_sha256_context *ctx, const unsigned char *data, size_t len) { return SHA256_Update(ctx, data, len) == 1 ? 0 : -1; }
+inline int mbedtls_sha256_finish(mbedtls_sha256_context *ctx, unsigned char *out) { return SHA256_Final(out, ctx) == 1 ? 0 : -1; }
+inline void mbedtls_sha256_free(mbedtls_sha256_context *) {}
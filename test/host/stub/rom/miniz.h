@@ -0,0 +1,68 @@
+// Host stub: the tinfl interface of the ROM decompressor on top of zlib (raw deflate)
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <zlib.h>
+
+#define TINFL_LZ_DICT_SIZE 32768
+#define TINFL_FLAG_HAS_MORE_INPUT 2
+
+typedef enum {
+  TINFL_STATUS_FAILED = -1,
+  TINFL_STATUS_DONE = 0,
+  TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+  TINFL_STATUS_HAS_MORE_OUTPUT = 2
+} tinfl_status;
+
+typedef struct {
+  uint32_t m_state; // 0 = not started, 1 = running, 2 = done
+} tinfl_decompressor;
+
+// one stream at a time (as on the device) - the zlib state is kept here, so an aborted stream is released by the next one
+static z_stream hostInflate;
+static bool hostInflateActive = false;
+
+#define tinfl_init(r)                                                                                                                                \
+  do {                                                                                                                                               \
+    (r)->m_state = 0;                                                                                                                                \
+  } while (0)
+
+// zlib keeps its own window - the output is written to out, the window of the caller is not used as history
+inline tinfl_status tinfl_decompress(tinfl_decompressor *r, const uint8_t *in, size_t *inSize, uint8_t *, uint8_t *out, size_t *outSize, uint32_t) {
+  z_stream &z = hostInflate;
+  if (r->m_state == 0) {
+    if (hostInflateActive) {
+      inflateEnd(&z);
+    }
+    memset(&z, 0, sizeof(z));
+    inflateInit2(&z, -15);
+    hostInflateActive = true;
+    r->m_state = 1;
+  }
+  if (r->m_state == 2) {
+    *inSize = 0;
+    *outSize = 0;
+    return TINFL_STATUS_DONE;
+  }
+  z.next_in = (Bytef *)in;
+  z.avail_in = *inSize;
+  z.next_out = out;
+  z.avail_out = *outSize;
+  int ret = inflate(&z, Z_NO_FLUSH);
+  *inSize -= z.avail_in;
+  *outSize -= z.avail_out;
+  if (ret == Z_STREAM_END) {
+    r->m_state = 2;
+    inflateEnd(&z);
+    hostInflateActive = false;
+    return TINFL_STATUS_DONE;
+  }
+  if (ret != Z_OK && ret != Z_BUF_ERROR) {
+    inflateEnd(&z);
+    hostInflateActive = false;
+    r->m_state = 2;
+    return TINFL_STATUS_FAILED;
+  }
+  return z.avail_out == 0 ? TINFL_STATUS_HAS_MORE_OUTPUT : TINFL_STATUS_NEEDS_MORE_INPUT;
+}
@@ -0,0 +1,75 @@
+// Host test of the RFC 5424 formatter (src/syslogFormat.cpp)
+//
+// The formatted messages are sent to a UDP listener on localhost and
+// compared with the datagrams that arrive there.
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <syslogFormat.h>
+#include <unistd.h>
+
+static int failed = 0;
+
+static void check(const char *name, const char *got, const char *expected) {
+  if (strcmp(got, expected) != 0) {
+    printf("FAIL %s\n  got:      %s\n  expected: %s\n", name, got, expected);
+    failed++;
+  } else {
+    printf("ok   %s\n", name);
+  }
+}
+
+// send message via UDP and return the received datagram
+static void roundTrip(int tx, int rx, const sockaddr_in &addr, const char *msg, size_t len, char *out, size_t size) {
+  sendto(tx, msg, len, 0, (const sockaddr *)&addr, sizeof(addr));
+  ssize_t n = recv(rx, out, size - 1, 0);
+  out[n > 0 ? n : 0] = '\0';
+}
+
+int main() {
+  int rx = socket(AF_INET, SOCK_DGRAM, 0);
+  int tx = socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t addrLen = sizeof(addr);
+  timeval timeout = {2, 0};
+  if (rx < 0 || tx < 0 || bind(rx, (sockaddr *)&addr, sizeof(addr)) < 0 || getsockname(rx, (sockaddr *)&addr, &addrLen) < 0) {
+    perror("socket");
+    return 1;
+  }
+  setsockopt(rx, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  char msg[256];
+  char got[512];
+  size_t len;
+
+  // 2024-01-02 03:04:05 UTC, severity 3 (error), facility 1 -> PRI 11
+  len = syslogFormat(msg, sizeof(msg), 3, 1704164645, "esp-webui", "EspWebUI", "MQTT", "connection lost");
+  roundTrip(tx, rx, addr, msg, len, got, sizeof(got));
+  check("full message", got, "<11>1 2024-01-02T03:04:05Z esp-webui EspWebUI - MQTT - connection lost");
+
+  // time before NTP sync and empty fields are sent as NILVALUE
+  len = syslogFormat(msg, sizeof(msg), 6, 1000, "", NULL, "", "boot");
+  roundTrip(tx, rx, addr, msg, len, got, sizeof(got));
+  check("nil values", got, "<14>1 - - - - - - boot");
+
+  // long messages are truncated to the buffer size
+  char text[300];
+  memset(text, 'x', sizeof(text) - 1);
+  text[sizeof(text) - 1] = '\0';
+  len = syslogFormat(msg, 64, 7, 1704164645, "h", "a", "T", text);
+  roundTrip(tx, rx, addr, msg, len, got, sizeof(got));
+  check("truncated", got, "<15>1 2024-01-02T03:04:05Z h a - T - xxxxxxxxxxxxxxxxxxxxxxxxxx");
+  if (len != 63) {
+    printf("FAIL truncated length %zu\n", len);
+    failed++;
+  }
+
+  close(rx);
+  close(tx);
+  printf("%s\n", failed ? "FAILED" : "all tests passed");
+  return failed ? 1 : 0;
+}
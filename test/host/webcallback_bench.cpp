@@ -0,0 +1,85 @@
+// Host benchmark of the element id dispatch in webCallback() (src/webUIcallback.cpp)
+//
+// strcmp chain (before) versus hash switch with one strcmp for the selected case.
+// The element ids are taken from webUIcallback.cpp by run.sh (webcallback_ids.inc).
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+static volatile uint32_t sink;
+
+static constexpr uint32_t webIdHash(const char *str, uint32_t hash = 2166136261UL) {
+  return *str ? webIdHash(str + 1, (hash ^ (uint8_t)*str) * 16777619UL) : hash;
+}
+
+static const char *const ids[] = {
+#define WEB_ID_CASE(id) id,
+#include "webcallback_ids.inc"
+#undef WEB_ID_CASE
+};
+static const int idCount = sizeof(ids) / sizeof(ids[0]);
+
+// before: compare with every known id
+__attribute__((noinline)) static bool dispatchChain(const char *elementId) {
+  for (int i = 0; i < idCount; i++) {
+    if (strcmp(elementId, ids[i]) == 0) {
+      sink = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+// after: switch on the hash, compare the id of the selected case
+__attribute__((noinline)) static bool dispatchSwitch(const char *elementId) {
+  switch (webIdHash(elementId)) {
+#define WEB_ID_CASE(id)                                                                                                                              \
+  case webIdHash(id):                                                                                                                                \
+    if (strcmp(elementId, id) != 0) {                                                                                                                \
+      return false;                                                                                                                                  \
+    }                                                                                                                                                \
+    sink = webIdHash(id);                                                                                                                            \
+    return true;
+#include "webcallback_ids.inc"
+#undef WEB_ID_CASE
+  default:
+    return false;
+  }
+}
+
+template <typename F> static double measure(F dispatch, int rounds) {
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (int i = 0; i < idCount; i++) {
+      dispatch(ids[i]);
+    }
+  }
+  std::chrono::duration<double, std::nano> ns = std::chrono::steady_clock::now() - start;
+  return ns.count() / rounds / idCount;
+}
+
+int main() {
+  // both variants must agree - including unknown ids
+  const char *unknown[] = {"p00_unknown", "cfg_wifi_ssid_", "", "cfg_wifi"};
+  for (int i = 0; i < idCount; i++) {
+    if (!dispatchChain(ids[i]) || !dispatchSwitch(ids[i])) {
+      printf("FAIL id not dispatched: %s\n", ids[i]);
+      return 1;
+    }
+  }
+  for (const char *id : unknown) {
+    if (dispatchChain(id) || dispatchSwitch(id)) {
+      printf("FAIL unknown id dispatched: %s\n", id);
+      return 1;
+    }
+  }
+
+  const int rounds = 20000;
+  double chain = measure(dispatchChain, rounds);
+  double hash = measure(dispatchSwitch, rounds);
+  printf("element ids:     %d\n", idCount);
+  printf("strcmp chain:    %6.1f ns/event\n", chain);
+  printf("hash switch:     %6.1f ns/event (incl. strcmp of the selected case)\n", hash);
+  return 0;
+}
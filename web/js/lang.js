@@ -74,4 +74,76 @@ const user_translations = {
     de: "Tabelle",
     en: "Table",
   },
+  log_filter_all: {
+    de: "Filter: alle",
+    en: "Filter: all",
+  },
+  log_filter_1: {
+    de: "Filter: Fehler",
+    en: "Filter: Error",
+  },
+  log_filter_2: {
+    de: "Filter: Warnung",
+    en: "Filter: Warning",
+  },
+  log_filter_3: {
+    de: "Filter: Info",
+    en: "Filter: Info",
+  },
+  log_filter_4: {
+    de: "Filter: Debug",
+    en: "Filter: Debug",
+  },
+  log_tag_level: {
+    de: "Log-Level pro Tag",
+    en: "Log level per tag",
+  },
+  log_mode_0: {
+    de: "Modus: global",
+    en: "Mode: global",
+  },
+  ws_saved: {
+    de: "WebSocket eingespart",
+    en: "WebSocket saved",
+  },
+  ws_compact: {
+    de: "WebSocket Kompression",
+    en: "WebSocket compression",
+  },
+  perf: {
+    de: "Performance",
+    en: "Performance",
+  },
+  loop_latency: {
+    de: "Laufzeiten (µs)",
+    en: "Run times (µs)",
+  },
+  task: {
+    de: "Task",
+    en: "Task",
+  },
+  histogram: {
+    de: "Histogramm",
+    en: "Histogram",
+  },
+  log_time_all: {
+    de: "Zeitraum: alle",
+    en: "Period: all",
+  },
+  log_time_5m: {
+    de: "Zeitraum: 5 Minuten",
+    en: "Period: 5 minutes",
+  },
+  log_time_1h: {
+    de: "Zeitraum: 1 Stunde",
+    en: "Period: 1 hour",
+  },
+  log_time_24h: {
+    de: "Zeitraum: 24 Stunden",
+    en: "Period: 24 hours",
+  },
+  log_export: {
+    de: "Logger-Export (Topic: /log)",
+    en: "Logger export (topic: /log)",
+  },
 };
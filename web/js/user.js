@@ -10,3 +10,165 @@ document.addEventListener("DOMContentLoaded", function () {
 function myFun() {
   // do what you want here
 }
+
+// report the visible page to the server - only values of visible pages are sent
+const pageReportInterval = 5000;
+let pageReport = { socket: null, page: "", time: 0 };
+function reportVisiblePage() {
+  if (typeof ws === "undefined" || ws.readyState !== WebSocket.OPEN) {
+    return;
+  }
+  const activeTab = document.querySelector(".tab-content.active");
+  const page = document.hidden || !activeTab ? "none" : activeTab.id;
+  const now = Date.now();
+  // send on page change, after (re)connect and as keep-alive
+  if (
+    page !== pageReport.page ||
+    ws !== pageReport.socket ||
+    now - pageReport.time >= pageReportInterval
+  ) {
+    sendData("p00_page", page);
+    pageReport = { socket: ws, page: page, time: now };
+  }
+}
+
+document.addEventListener("DOMContentLoaded", function () {
+  document.querySelectorAll(".nav-list a").forEach((tab) => {
+    tab.addEventListener("click", reportVisiblePage);
+  });
+  document.addEventListener("visibilitychange", reportVisiblePage);
+  setInterval(reportVisiblePage, 500);
+});
+
+// decoder for compact element updates (see webUIelements.cpp)
+// binary frame (decodeElements) or {"type":"elements","c":client,"d":[idx,"id",...],"v":[idx,value,...],"j":{"id":value}}
+let elementIds = [];
+let elementClient = 0; // id of this browser on the server (sent with the dictionary)
+let unknownValues = {}; // latest values of unknown indices - applied when the dictionary arrives
+let dictRequested = false;
+function updateElements(message) {
+  const data = message.j || {};
+  if (message.c !== undefined) {
+    // dictionary of all element indices for this browser
+    elementClient = message.c;
+    dictRequested = false;
+  }
+  const d = message.d || [];
+  for (let i = 0; i + 1 < d.length; i += 2) {
+    elementIds[d[i]] = d[i + 1];
+    if (d[i] in unknownValues) {
+      data[d[i + 1]] = unknownValues[d[i]];
+      delete unknownValues[d[i]];
+    }
+  }
+  const v = message.v || [];
+  for (let i = 0; i + 1 < v.length; i += 2) {
+    const id = elementIds[v[i]];
+    if (id === undefined) {
+      // index is unknown (e.g. missed dictionary) - request the dictionary for this browser
+      unknownValues[v[i]] = v[i + 1];
+      if (!dictRequested) {
+        dictRequested = true;
+        sendData("p00_elements_reset", String(elementClient));
+      }
+      continue;
+    }
+    data[id] = v[i + 1];
+  }
+  updateJSON(data);
+}
+
+// binary element frame: 0xE5, then records of type (byte), key and typed value
+// key: element index (byte) or element id (string) if bit 7 of the type is set
+// string: length (varint) + UTF-8 chars
+const elementFrame = 0xe5;
+const elementRecord = { client: 1, dict: 2, int: 3, float: 4, string: 5, icon: 6, named: 0x80 };
+const elementText = new TextDecoder();
+function decodeElements(buffer) {
+  const bytes = new Uint8Array(buffer);
+  const view = new DataView(buffer);
+  const message = { d: [], v: [], j: {} };
+  let pos = 1;
+  const varint = () => {
+    let value = 0;
+    let scale = 1;
+    let b;
+    do {
+      b = bytes[pos++];
+      value += (b & 0x7f) * scale;
+      scale *= 128;
+    } while (b & 0x80);
+    return value;
+  };
+  const string = () => {
+    const len = varint();
+    pos += len;
+    return elementText.decode(bytes.subarray(pos - len, pos));
+  };
+  if (bytes[0] !== elementFrame) {
+    return null;
+  }
+  while (pos < bytes.length) {
+    const type = bytes[pos++];
+    if (type === elementRecord.client) {
+      message.c = varint();
+      continue;
+    }
+    const key = type & elementRecord.named ? string() : bytes[pos++];
+    let value;
+    switch (type & ~elementRecord.named) {
+      case elementRecord.dict:
+        message.d.push(key, string());
+        continue;
+      case elementRecord.int:
+        value = varint();
+        value = value % 2 ? -(value + 1) / 2 : value / 2; // zigzag
+        break;
+      case elementRecord.float:
+        value = Number(view.getFloat32(pos, true).toPrecision(7));
+        pos += 4;
+        break;
+      case elementRecord.string:
+        value = string();
+        break;
+      case elementRecord.icon:
+        value = "i_" + string();
+        break;
+      default:
+        console.warn("unknown element record", type);
+        return null;
+    }
+    if (type & elementRecord.named) {
+      message.j[key] = value;
+    } else {
+      message.v.push(key, value);
+    }
+  }
+  return message;
+}
+
+// extend WebSocket setup of lib.js with the compact element decoder
+// binary frames are not passed to the JSON handler of lib.js
+const libSetupWS = setupWS;
+setupWS = function () {
+  elementIds = [];
+  elementClient = 0;
+  unknownValues = {};
+  dictRequested = false;
+  libSetupWS();
+  ws.binaryType = "arraybuffer";
+  const libMessage = ws.onmessage;
+  ws.onmessage = function (event) {
+    if (event.data instanceof ArrayBuffer) {
+      const message = decodeElements(event.data);
+      if (message) {
+        updateElements(message);
+      }
+      return;
+    }
+    libMessage(event);
+    if (event.data.startsWith('{"type":"elements"')) {
+      updateElements(JSON.parse(event.data));
+    }
+  };
+};